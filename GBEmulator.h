@@ -3,7 +3,9 @@
 #include <optional>
 #include <string>
 #include "SDLWindow.h"
+#include "boot_state_cache.h"
 #include "main_loop.h"
+#include "netplay_session.h"
 #include "rom_loader.h"
 
 template <typename UI>
@@ -15,6 +17,13 @@ public:
   // Run loop if constructed
   void run();
   void set_boot_rom(const std::string& path);
+  // Frames to run ahead of the real one to hide input lag, 0 to disable. Also adjustable with F6/F7.
+  void set_run_ahead(uint32_t frames);
+  // Multiple of real-time speed, or MainLoop::UNCAPPED_SPEED. F9 steps through 1x, 2x, 4x, 8x and uncapped.
+  void set_speed(uint32_t speed);
+  // Restart the current ROM and play it together with a peer running the same ROM, both controlling one Game
+  // Boy. Ends when another ROM or save state is loaded.
+  void start_netplay(uint16_t local_port, const std::string& peer_host, uint16_t peer_port);
 
 private:
   void open_rom(const std::string& path);
@@ -24,6 +33,7 @@ private:
   void quick_load();
   void show_error(const std::string& title, const std::string& message);
   OSBridge get_os_bridge();
+  void start_from_boot_state_cache(OSBridge& bridge);
   std::string get_rom_name_without_extension(const std::string& path);
 
   SDLWindow window_;
@@ -31,8 +41,12 @@ private:
   std::string current_rom_path_;
   std::string current_rom_name_;  // ROM filename without path and extension
   std::string boot_rom_path_;     // Path to boot ROM file
+  BootStateCache boot_state_cache_;
+  uint32_t run_ahead_frames_ = 0;
+  uint32_t speed_ = 1;
   std::optional<ROMLoader> loader_;
   std::optional<MainLoop> loop_;
+  std::optional<NetplaySession> netplay_;  // Drives loop_, so must be reset before loop_ is replaced
 };
 
 
@@ -10,4 +10,18 @@ struct OSBridge {
   std::function<void()> present_frame;
   std::function<bool(JoypadState& joypad_state)> handle_events;
   std::function<void(const uint32_t* pixels, size_t pitch)> blit_screen;
+  // Optional. Each frame as one shade per pixel, 0 (white) to 3 (black), before it is converted for blit_screen.
+  std::function<void(const uint8_t* shades, size_t pitch)> blit_shades;
+  // Optional, used instead of blit_screen. The same frame along with the scanlines that changed since the last one,
+  // first_line up to end_line, so only those need uploading. Equal when nothing changed.
+  std::function<void(const uint32_t* pixels, size_t pitch, uint32_t first_line, uint32_t end_line)> blit_changed_lines;
+  // Optional, used instead of the blits above so the frame needs no intermediate copy. The scanlines that changed
+  // since the last frame, first_line up to end_line, are converted straight into the buffer lock_frame hands out,
+  // which points at first_line and has pitch bytes per row. That can be the texture itself, or a frame the frontend
+  // keeps and scales from in place, at the cost of that one pass. lock_frame is skipped when nothing changed;
+  // unlock_frame never is. A null buffer leaves the lines to be sent again next frame.
+  std::function<uint32_t*(uint32_t first_line, uint32_t end_line, size_t& pitch)> lock_frame;
+  std::function<void()> unlock_frame;
+  // Optional. How full the audio device's buffer is, 1 being the level it aims for, for MainLoop's audio rate control.
+  std::function<double()> audio_buffer_fill;
 };
\ No newline at end of file
@@ -1,9 +1,18 @@
 #include "SDLWindow.h"
 #include <signal.h>
+#include <algorithm>
 #include <array>
 #include <csignal>
+#include <cstring>
 #include "utils.h"
 
+namespace {
+constexpr int AUDIO_QUEUE_MIN_SAMPLES = 960;   // 10ms at 48kHz stereo - increased to prevent underruns
+constexpr int AUDIO_QUEUE_MAX_SAMPLES = 4800;  // 50ms at 48kHz stereo
+// What audio rate control steers the queue towards, midway between the two
+constexpr int AUDIO_QUEUE_TARGET_SAMPLES = (AUDIO_QUEUE_MIN_SAMPLES + AUDIO_QUEUE_MAX_SAMPLES) / 2;
+}  // namespace
+
 void signal_handler(int signal) {
   std::exit(-1);
 }
@@ -31,8 +40,8 @@ SDLWindow::SDLWindow(const std::string& title, int width, int height)
     max_scale_factor_ = available_height / height;
     if (max_scale_factor_ < 1)
       max_scale_factor_ = 1;
-    if (max_scale_factor_ > 20)
-      max_scale_factor_ = 20;  // Reasonable upper limit
+    if (max_scale_factor_ > Upscaler::MAX_FACTOR)
+      max_scale_factor_ = Upscaler::MAX_FACTOR;  // Reasonable upper limit
 
     // Set default scale to be just above middle of range
     scale_factor_ = (max_scale_factor_ + 2) / 2;
@@ -57,12 +66,11 @@ SDLWindow::SDLWindow(const std::string& title, int width, int height)
     return;
   }
 
-  SDL_RenderSetLogicalSize(renderer_, width, height);
+  // No logical size: texture_ is always the size of the window, so presenting it needs no scaling by SDL
   SDL_SetHint(SDL_HINT_RENDER_SCALE_QUALITY, "0");
 
-  texture_ =
-      SDL_CreateTexture(renderer_, SDL_PIXELFORMAT_ARGB8888, SDL_TEXTUREACCESS_STREAMING, width, height);
-  if (!texture_) {
+  frame_.assign(width * height, 0);
+  if (!create_texture()) {
     SDL_DestroyRenderer(renderer_);
     SDL_DestroyWindow(window_);
     SDL_Quit();
@@ -137,11 +145,80 @@ void SDLWindow::present() {
   SDL_RenderPresent(renderer_);
 }
 
-void SDLWindow::blit_screen(const uint32_t* pixels, size_t pitch) {
-  SDL_UpdateTexture(texture_, nullptr, pixels, static_cast<int>(pitch));
+void SDLWindow::blit_screen(const uint32_t* pixels, size_t pitch, uint32_t first_line, uint32_t end_line) {
+  if (first_line < end_line) {
+    size_t locked_pitch = 0;
+    uint8_t* locked = reinterpret_cast<uint8_t*>(lock_screen(first_line, end_line, locked_pitch));
+    for (uint32_t y = first_line; y < end_line; y++) {
+      memcpy(locked + (y - first_line) * locked_pitch, reinterpret_cast<const uint8_t*>(pixels) + y * pitch,
+             base_width_ * sizeof(uint32_t));
+    }
+  }
+  unlock_screen();
+}
+
+uint32_t* SDLWindow::lock_screen(uint32_t first_line, uint32_t end_line, size_t& pitch) {
+  mark_frame_changed(first_line, end_line);
+  pitch = base_width_ * sizeof(uint32_t);
+  return &frame_[first_line * base_width_];
+}
+
+void SDLWindow::unlock_screen() {
+  draw_frame();
+}
+
+void SDLWindow::mark_frame_changed(uint32_t first_line, uint32_t end_line) {
+  if (changed_first_line_ == changed_end_line_) {
+    changed_first_line_ = first_line;
+    changed_end_line_ = end_line;
+  } else {
+    changed_first_line_ = std::min(changed_first_line_, first_line);
+    changed_end_line_ = std::max(changed_end_line_, end_line);
+  }
+}
+
+void SDLWindow::draw_frame() {
+  upload_frame();
   SDL_RenderCopy(renderer_, texture_, nullptr, nullptr);
 }
 
+void SDLWindow::upload_frame() {
+  uint32_t first_line = changed_first_line_;
+  uint32_t end_line = changed_end_line_;
+  // The LCD filter's ghosting fades on every frame, changed or not, and Smooth looks at the rows around each pixel
+  if (filter_ == Upscaler::Filter::LCD || (filter_ == Upscaler::Filter::Smooth && first_line < end_line)) {
+    first_line = 0;
+    end_line = base_height_;
+  }
+  if (first_line >= end_line) {
+    return;
+  }
+
+  const int factor = static_cast<int>(scale_factor_);
+  const SDL_Rect rows = {0, static_cast<int>(first_line) * factor, base_width_ * factor,
+                         static_cast<int>(end_line - first_line) * factor};
+  void* pixels = nullptr;
+  int pitch = 0;
+  if (SDL_LockTexture(texture_, &rows, &pixels, &pitch) == 0) {
+    upscaler_.scale(&frame_[first_line * base_width_], base_width_ * sizeof(uint32_t), base_width_,
+                    end_line - first_line, static_cast<uint32_t*>(pixels), pitch, scale_factor_, filter_);
+    SDL_UnlockTexture(texture_);
+    changed_first_line_ = 0;
+    changed_end_line_ = 0;
+  }
+}
+
+bool SDLWindow::create_texture() {
+  if (texture_) {
+    SDL_DestroyTexture(texture_);
+  }
+  // The size of the window, so presenting it is a plain copy
+  texture_ = SDL_CreateTexture(renderer_, SDL_PIXELFORMAT_ARGB8888, SDL_TEXTUREACCESS_STREAMING,
+                               base_width_ * scale_factor_, base_height_ * scale_factor_);
+  mark_frame_changed(0, base_height_);
+  return texture_ != nullptr;
+}
+
 bool SDLWindow::handleEvents(JoypadState& joypad_state) {
   SDL_Event event;
   while (SDL_PollEvent(&event)) {
@@ -191,6 +268,24 @@ bool SDLWindow::handleEvents(JoypadState& joypad_state) {
               on_quick_load_();
             }
             break;
+          case SDLK_F6:
+          case SDLK_F7:
+            if (on_run_ahead_change_) {
+              on_run_ahead_change_(event.key.keysym.sym == SDLK_F7 ? 1 : -1);
+            }
+            break;
+          case SDLK_F9:
+            if (on_turbo_cycle_) {
+              on_turbo_cycle_();
+            }
+            break;
+          case SDLK_F10:
+            filter_ = static_cast<Upscaler::Filter>((static_cast<uint32_t>(filter_) + 1) % Upscaler::FILTER_COUNT);
+            mark_frame_changed(0, base_height_);
+            break;
+          case SDLK_BACKSPACE:
+            rewind_held_ = true;
+            break;
           default:
             // Handle gamepad keys
             switch (event.key.keysym.sym) {
@@ -226,6 +321,9 @@ bool SDLWindow::handleEvents(JoypadState& joypad_state) {
       }
     } else if (event.type == SDL_KEYUP) {
       switch (event.key.keysym.sym) {
+        case SDLK_BACKSPACE:
+          rewind_held_ = false;
+          break;
         case SDLK_z:
           keyboard_state_.a_pressed = false;
           break;
@@ -384,11 +482,8 @@ void SDLWindow::queue_audio(const int16_t* samples, int num_samples) {
   Uint32 queued_bytes = SDL_GetQueuedAudioSize(audio_device_);
   int queued_samples = queued_bytes / sizeof(int16_t);
 
-  const int MIN = 960;   // 10ms at 48kHz stereo - increased to prevent underruns
-  const int MAX = 4800;  // 50ms at 48kHz stereo
-
-  if (queued_samples > (MAX * 2)) {
-  } else if (queued_samples < (MIN / 2)) {
+  if (queued_samples > (AUDIO_QUEUE_MAX_SAMPLES * 2)) {
+  } else if (queued_samples < (AUDIO_QUEUE_MIN_SAMPLES / 2)) {
     SDL_AudioStreamPut(audio_stream_, samples, num_samples * sizeof(int16_t));
     const uint32_t extra_samples = std::min(num_samples, 64);
     SDL_AudioStreamPut(audio_stream_, samples + num_samples - extra_samples, extra_samples * sizeof(int16_t));
@@ -397,7 +492,7 @@ void SDLWindow::queue_audio(const int16_t* samples, int num_samples) {
   }
 
   int available = SDL_AudioStreamAvailable(audio_stream_);
-  if (available > 0 && queued_samples < MAX) {
+  if (available > 0 && queued_samples < AUDIO_QUEUE_MAX_SAMPLES) {
     std::array<uint8_t, 20480> buffer;
     int received = SDL_AudioStreamGet(audio_stream_, buffer.data(), buffer.size());
     if (received > 0) {
@@ -414,17 +509,30 @@ int SDLWindow::get_queued_audio_samples() const {
   return queued_bytes / sizeof(int16_t);
 }
 
+double SDLWindow::audio_buffer_fill() const {
+  if (!audio_stream_ || audio_device_ == 0) {
+    return 1.0;
+  }
+  // Samples still in the stream are as good as queued, they just wait for room on the device
+  const int buffered_samples =
+      get_queued_audio_samples() + SDL_AudioStreamAvailable(audio_stream_) / static_cast<int>(sizeof(int16_t));
+  return static_cast<double>(buffered_samples) / AUDIO_QUEUE_TARGET_SAMPLES;
+}
+
 void SDLWindow::apply_scale_factor(uint32_t factor) {
   if (factor == 0 || scale_factor_ == factor || !window_) {
     return;
   }
 
-  scale_factor_ = factor;
+  scale_factor_ = std::min(factor, Upscaler::MAX_FACTOR);
 
   int scaled_width = base_width_ * static_cast<int>(scale_factor_);
   int scaled_height = base_height_ * static_cast<int>(scale_factor_);
 
   SDL_SetWindowSize(window_, scaled_width, scaled_height);
+  if (!create_texture()) {
+    FATAL("Can't create SDL Texture");
+  }
 }
 
 void SDLWindow::prepare_for_pause() {
@@ -5,7 +5,9 @@
 #include <cstdint>
 #include <functional>
 #include <string>
+#include <vector>
 #include "joypad_state.h"
+#include "upscaler.h"
 
 class SDLWindow {
 public:
@@ -15,7 +17,13 @@ public:
   void clear();
   void present();
 
-  void blit_screen(const uint32_t* pixels, size_t pitch);
+  // Takes scanlines first_line up to end_line of the frame, the rest being as last taken, and draws it
+  void blit_screen(const uint32_t* pixels, size_t pitch, uint32_t first_line, uint32_t end_line);
+  // The window's copy of the frame from first_line on, for scanlines first_line up to end_line to be drawn straight
+  // into. unlock_screen scales it up into the texture from there, so a changed frame costs exactly one pass at any
+  // scale or filter, and draws the frame whether or not anything was locked.
+  uint32_t* lock_screen(uint32_t first_line, uint32_t end_line, size_t& pitch);
+  void unlock_screen();
   // Handle events and return true if window should close
   bool handleEvents(JoypadState& joypad_state);
 
@@ -28,6 +36,11 @@ public:
 
   // Get current queued audio sample count
   int get_queued_audio_samples() const;
+  // Queued and streaming audio as a fraction of the level midway between the least and most queue_audio keeps
+  double audio_buffer_fill() const;
+
+  // True while the rewind key (Backspace) is held down
+  bool rewind_held() const { return rewind_held_; }
 
   // Callbacks for keyboard shortcuts
   void set_on_quick_save(std::function<void()> cb) { on_quick_save_ = std::move(cb); }
@@ -35,6 +48,10 @@ public:
   void set_on_open_rom(std::function<void()> cb) { on_open_rom_ = std::move(cb); }
   void set_on_save(std::function<void()> cb) { on_save_ = std::move(cb); }
   void set_on_exit(std::function<void()> cb) { on_exit_ = std::move(cb); }
+  // Called with -1 (F6) or +1 (F7) to change how many frames run ahead
+  void set_on_run_ahead_change(std::function<void(int)> cb) { on_run_ahead_change_ = std::move(cb); }
+  // Called when F9 is pressed to step to the next turbo speed
+  void set_on_turbo_cycle(std::function<void()> cb) { on_turbo_cycle_ = std::move(cb); }
 
   // Audio pause/resume methods (for blocking operations like file dialogs)
   void prepare_for_pause();  // Call before blocking operations
@@ -50,7 +67,15 @@ public:
 private:
   SDL_Window* window_;
   SDL_Renderer* renderer_;
-  SDL_Texture* texture_ = nullptr;
+  SDL_Texture* texture_ = nullptr;  // Window sized, the frame scaled up by upscaler_
+
+  // Frames are scaled up to the window and filtered here rather than by SDL's renderer. F10 cycles the filter.
+  // frame_ always holds the whole frame; texture_ is only ever written from it.
+  std::vector<uint32_t> frame_;
+  uint32_t changed_first_line_ = 0;  // Rows of frame_ changed since texture_ was last drawn from it
+  uint32_t changed_end_line_ = 0;
+  Upscaler upscaler_;
+  Upscaler::Filter filter_ = Upscaler::Filter::Nearest;
 
   // Audio members
   SDL_AudioDeviceID audio_device_;
@@ -66,6 +91,7 @@ private:
   // Track left stick axes for controller directional mapping
   int16_t controller_lx_ = 0;
   int16_t controller_ly_ = 0;
+  bool rewind_held_ = false;
   uint32_t scale_factor_ = 4;
   uint32_t max_scale_factor_ = 10;  // Will be calculated based on monitor resolution
   int base_width_ = 0;
@@ -77,6 +103,16 @@ private:
   std::function<void()> on_open_rom_;
   std::function<void()> on_save_;
   std::function<void()> on_exit_;
+  std::function<void(int)> on_run_ahead_change_;
+  std::function<void()> on_turbo_cycle_;
 
   std::vector<int16_t> last_audio_samples_;
+
+  // upload_frame, then copies texture_ to the screen
+  void draw_frame();
+  // Scales the changed rows of frame_ into texture_, or all of them for filters that need it
+  void upload_frame();
+  void mark_frame_changed(uint32_t first_line, uint32_t end_line);
+  // (Re)creates texture_ at the window's size
+  bool create_texture();
 };
\ No newline at end of file
@@ -126,16 +126,36 @@ bool APU::is_length_register(uint16_t address) {
 }
 
 void APU::serialize(SaveStateSerializer& serializer) const {
-  serializer << audio_registers_;
+  serializer << audio_registers_.registers_;
+  serializer << audio_registers_.wave_ram_;
+  serializer << audio_registers_.last_wave_ram_access_;
   serializer << master_enabled_;
+  frame_sequencer_.serialize(serializer);
+  mixer_.serialize(serializer);
+  serializer << sample_counter_;
+  serializer << apu_clock_;
 }
 
 void APU::deserialize(SaveStateSerializer& serializer) {
-  serializer >> audio_registers_;
+  serializer >> audio_registers_.registers_;
+  serializer >> audio_registers_.wave_ram_;
+  // Versions before 3 copied the whole register block, including the padding byte before the access time
+  if (serializer.section_older_than(3)) {
+    uint8_t padding;
+    serializer >> padding;
+  }
+  serializer >> audio_registers_.last_wave_ram_access_;
   serializer >> master_enabled_;
-
-  audio_register_write(NR26_ADDR, audio_registers_.read_register(NR26_ADDR));
-  for (uint16_t i = AUDIO_REG_START; i < AUDIO_REG_END; i++) {
-    audio_register_write(i, audio_registers_.read_register(i));
+  // Version 1 sections only hold the registers, so the channels are rebuilt by replaying the writes
+  if (serializer.section_older_than(2)) {
+    audio_register_write(NR26_ADDR, audio_registers_.read_register(NR26_ADDR));
+    for (uint16_t i = AUDIO_REG_START; i < AUDIO_REG_END; i++) {
+      audio_register_write(i, audio_registers_.read_register(i));
+    }
+    return;
   }
+  frame_sequencer_.deserialize(serializer);
+  mixer_.deserialize(serializer);
+  serializer >> sample_counter_;
+  serializer >> apu_clock_;
 }
\ No newline at end of file
@@ -26,6 +26,8 @@ public:
   void audio_register_write(uint16_t address, uint8_t value);
   const unsigned char* audio_register_read(uint16_t address) const;
 
+  // Version 3 writes the register block and the noise channel field by field, leaving out padding
+  static constexpr uint32_t SAVE_STATE_VERSION = 3;
   void serialize(SaveStateSerializer& serializer) const;
   void deserialize(SaveStateSerializer& serializer);
 
@@ -0,0 +1,26 @@
+#include "audio_decimator.h"
+#include <algorithm>
+
+void AudioDecimator::set_ratio(double ratio) {
+  ratio_ = std::max(ratio, 1.0);
+}
+
+std::span<const int16_t> AudioDecimator::process(const int16_t* samples, int num_samples) {
+  output_.clear();
+  for (int i = 0; i + 1 < num_samples; i += 2) {
+    sum_left_ += samples[i];
+    sum_right_ += samples[i + 1];
+    count_++;
+    accumulated_ += 1.0;
+
+    if (accumulated_ >= ratio_) {
+      output_.push_back(static_cast<int16_t>(sum_left_ / count_));
+      output_.push_back(static_cast<int16_t>(sum_right_ / count_));
+      accumulated_ -= ratio_;
+      sum_left_ = 0;
+      sum_right_ = 0;
+      count_ = 0;
+    }
+  }
+  return output_;
+}
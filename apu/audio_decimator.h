@@ -0,0 +1,26 @@
+#pragma once
+
+#include <cstdint>
+#include <span>
+#include <vector>
+
+// Squeezes audio emulated faster than real time back into a real-time stream (stereo int16, like the APU's
+// output) by averaging every ratio consecutive frames into one. The pitch goes up with the speed, but the
+// averaging filters out most of what would otherwise alias, and nothing queues up behind the audio device.
+class AudioDecimator {
+public:
+  // Input frames per output frame; anything below 1 passes the audio through unchanged
+  void set_ratio(double ratio);
+  double ratio() const { return ratio_; }
+
+  // The decimated samples stay valid until the next call
+  std::span<const int16_t> process(const int16_t* samples, int num_samples);
+
+private:
+  double ratio_ = 1.0;
+  double accumulated_ = 0.0;  // Input frames summed towards the next output frame, carried between calls
+  int32_t sum_left_ = 0;
+  int32_t sum_right_ = 0;
+  int32_t count_ = 0;
+  std::vector<int16_t> output_;
+};
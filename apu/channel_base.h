@@ -5,6 +5,7 @@
 #include "audio_registers.h"
 #include "dac.h"
 #include "frame_sequencer.h"
+#include "save_state.h"
 
 template <typename Parent, typename Traits>
 class ChannelBase {
@@ -53,6 +54,22 @@ public:
     audio_registers_.set_NR52_internal(audio_registers_.get_NR52() | (1 << Traits::NR52_BIT));
   }
 
+  void serialize(SaveStateSerializer& serializer) const {
+    serializer << enabled_;
+    serializer << left_enabled_;
+    serializer << right_enabled_;
+    length_timer_.serialize(serializer);
+    dac_.serialize(serializer);
+  }
+
+  void deserialize(SaveStateSerializer& serializer) {
+    serializer >> enabled_;
+    serializer >> left_enabled_;
+    serializer >> right_enabled_;
+    length_timer_.deserialize(serializer);
+    dac_.deserialize(serializer);
+  }
+
 protected:
   float enabled_ = CHANNEL_DISABLED;
   float left_enabled_ = CHANNEL_DISABLED;
@@ -1,4 +1,5 @@
 #include "LFSR.h"
+#include "save_state.h"
 
 LFSR::LFSR() = default;
 
@@ -17,3 +18,20 @@ void LFSR::trigger() {
 uint8_t LFSR::get_output() const {
   return ~lfsr_ & 1;
 }
+
+void LFSR::serialize(SaveStateSerializer& serializer) const {
+  serializer << timer_;
+  serializer << lfsr_;
+  serializer << width_;
+}
+
+void LFSR::deserialize(SaveStateSerializer& serializer) {
+  serializer >> timer_;
+  serializer >> lfsr_;
+  serializer >> width_;
+  // APU version 2 copied the whole object, including its trailing padding byte
+  if (serializer.section_older_than(3)) {
+    uint8_t padding;
+    serializer >> padding;
+  }
+}
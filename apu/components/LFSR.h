@@ -3,6 +3,8 @@
 #include <cstdint>
 #include "frequency_timer.h"
 
+class SaveStateSerializer;
+
 class LFSR {
 public:
   LFSR();
@@ -23,6 +25,9 @@ public:
   void trigger();
   void master_enable();
 
+  void serialize(SaveStateSerializer& serializer) const;
+  void deserialize(SaveStateSerializer& serializer);
+
 private:
   FrequencyTimerChannel4 timer_;
   uint16_t lfsr_ = 0xFFFF;
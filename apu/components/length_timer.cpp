@@ -1,6 +1,7 @@
 #include "length_timer.h"
 #include "audio_constants.h"
 #include "frame_sequencer.h"
+#include "save_state.h"
 
 template <uint32_t BASE_LENGTH>
 LengthTimerInternal<BASE_LENGTH>::LengthTimerInternal(FrameSequencer& frame_sequencer,
@@ -42,5 +43,21 @@ void LengthTimerInternal<BASE_LENGTH>::set_length(uint16_t length_register) {
   timer_ = BASE_LENGTH - length_register;
 }
 
+template <uint32_t BASE_LENGTH>
+void LengthTimerInternal<BASE_LENGTH>::serialize(SaveStateSerializer& serializer) const {
+  serializer << enabled_;
+  serializer << should_play_;
+  serializer << timer_;
+  serializer << length_register_;
+}
+
+template <uint32_t BASE_LENGTH>
+void LengthTimerInternal<BASE_LENGTH>::deserialize(SaveStateSerializer& serializer) {
+  serializer >> enabled_;
+  serializer >> should_play_;
+  serializer >> timer_;
+  serializer >> length_register_;
+}
+
 template class LengthTimerInternal<64>;
 template class LengthTimerInternal<256>;
\ No newline at end of file
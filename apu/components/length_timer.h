@@ -5,6 +5,7 @@
 #include "audio_constants.h"
 
 class FrameSequencer;
+class SaveStateSerializer;
 
 template <uint32_t BASE_LENGTH>
 class LengthTimerInternal {
@@ -31,6 +32,9 @@ public:
 
   [[gnu::always_inline]] float should_play() const { return should_play_; }
 
+  void serialize(SaveStateSerializer& serializer) const;
+  void deserialize(SaveStateSerializer& serializer);
+
 private:
   void start();
 
@@ -1,5 +1,6 @@
 #include "sweep.h"
 #include "audio_registers.h"
+#include "save_state.h"
 
 // Sweep frequency overflow threshold
 constexpr uint16_t MAX_FREQUENCY = 2047;
@@ -104,3 +105,23 @@ void Sweep::write_frequency_to_registers(uint16_t frequency) {
     frequency_update_callback_(frequency);
   }
 }
+
+void Sweep::serialize(SaveStateSerializer& serializer) const {
+  serializer << shadow_frequency_;
+  serializer << calculation_count_;
+  serializer << pace_;
+  serializer << timer_;
+  serializer << negate_;
+  serializer << shift_;
+  serializer << enabled_;
+}
+
+void Sweep::deserialize(SaveStateSerializer& serializer) {
+  serializer >> shadow_frequency_;
+  serializer >> calculation_count_;
+  serializer >> pace_;
+  serializer >> timer_;
+  serializer >> negate_;
+  serializer >> shift_;
+  serializer >> enabled_;
+}
@@ -4,6 +4,7 @@
 #include <functional>
 
 class AudioRegisters;
+class SaveStateSerializer;
 
 class Sweep {
 public:
@@ -14,6 +15,9 @@ public:
   void set_overflow_callback(std::function<void()> callback);
   void set_frequency_update_callback(std::function<void(uint16_t)> callback);
 
+  void serialize(SaveStateSerializer& serializer) const;
+  void deserialize(SaveStateSerializer& serializer);
+
 private:
   uint16_t calculate_new_frequency();
   void write_frequency_to_registers(uint16_t frequency);
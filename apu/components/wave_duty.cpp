@@ -1,5 +1,6 @@
 #include "wave_duty.h"
 #include <cstdint>
+#include "save_state.h"
 
 WaveDuty::WaveDuty() = default;
 
@@ -25,4 +26,16 @@ uint8_t WaveDuty::get_output() const {
 
 uint16_t WaveDuty::get_frequency() const {
   return timer_.get_frequency();
-}
\ No newline at end of file
+}
+
+void WaveDuty::serialize(SaveStateSerializer& serializer) const {
+  serializer << duty_position_;
+  serializer << duty_pattern_;
+  serializer << timer_;
+}
+
+void WaveDuty::deserialize(SaveStateSerializer& serializer) {
+  serializer >> duty_position_;
+  serializer >> duty_pattern_;
+  serializer >> timer_;
+}
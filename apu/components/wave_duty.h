@@ -4,6 +4,8 @@
 #include <cstdint>
 #include "frequency_timer.h"
 
+class SaveStateSerializer;
+
 class WaveDuty {
 public:
   WaveDuty();
@@ -23,6 +25,9 @@ public:
   uint16_t get_frequency() const;
 
   void master_enable();
+
+  void serialize(SaveStateSerializer& serializer) const;
+  void deserialize(SaveStateSerializer& serializer);
   void trigger() {}
 
 private:
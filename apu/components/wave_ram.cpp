@@ -1,5 +1,6 @@
 #include "wave_ram.h"
 #include "audio_registers.h"
+#include "save_state.h"
 
 WaveRAM::WaveRAM(AudioRegisters& audio_registers) : audio_registers_(audio_registers) {}
 
@@ -55,4 +56,22 @@ uint16_t WaveRAM::get_timer_counter() const {
 
 uint8_t WaveRAM::ram_position() const {
   return ram_position_;
-}
\ No newline at end of file
+}
+
+void WaveRAM::serialize(SaveStateSerializer& serializer) const {
+  serializer << current_sample_;
+  serializer << ram_position_;
+  serializer << timer_;
+  serializer << volume_;
+  serializer << volume_shift_;
+  serializer << enabled_;
+}
+
+void WaveRAM::deserialize(SaveStateSerializer& serializer) {
+  serializer >> current_sample_;
+  serializer >> ram_position_;
+  serializer >> timer_;
+  serializer >> volume_;
+  serializer >> volume_shift_;
+  serializer >> enabled_;
+}
@@ -4,6 +4,7 @@
 #include "frequency_timer.h"
 
 class AudioRegisters;
+class SaveStateSerializer;
 
 class WaveRAM {
 public:
@@ -33,6 +34,9 @@ public:
 
   void disable();
 
+  void serialize(SaveStateSerializer& serializer) const;
+  void deserialize(SaveStateSerializer& serializer);
+
 private:
   void load_sample(uint32_t apu_clock);
   AudioRegisters& audio_registers_;
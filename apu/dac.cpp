@@ -2,6 +2,7 @@
 #include "LFSR.h"
 #include "audio_constants.h"
 #include "frame_sequencer.h"
+#include "save_state.h"
 #include "wave_duty.h"
 
 // DAC output normalization constant
@@ -77,6 +78,22 @@ float DAC<Frequency>::output() const {
   return (static_cast<float>(input) / DAC_NORMALIZATION) - 1.0f;
 }
 
+template <typename Frequency>
+void DAC<Frequency>::serialize(SaveStateSerializer& serializer) const {
+  serializer << enabled_;
+  duty_.serialize(serializer);
+  serializer << envelope_;
+  serializer << next_envelope_;
+}
+
+template <typename Frequency>
+void DAC<Frequency>::deserialize(SaveStateSerializer& serializer) {
+  serializer >> enabled_;
+  duty_.deserialize(serializer);
+  serializer >> envelope_;
+  serializer >> next_envelope_;
+}
+
 // Explicit template instantiation
 template class DAC<WaveDuty>;
 template class DAC<LFSR>;
@@ -125,4 +142,14 @@ uint8_t WaveRAMDAC::ram_position() const {
 
 uint16_t WaveRAMDAC::get_timer_counter() const {
   return wave_ram_.get_timer_counter();
-}
\ No newline at end of file
+}
+
+void WaveRAMDAC::serialize(SaveStateSerializer& serializer) const {
+  serializer << enabled_;
+  wave_ram_.serialize(serializer);
+}
+
+void WaveRAMDAC::deserialize(SaveStateSerializer& serializer) {
+  serializer >> enabled_;
+  wave_ram_.deserialize(serializer);
+}
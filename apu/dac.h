@@ -6,6 +6,7 @@
 
 class FrameSequencer;
 class AudioRegisters;
+class SaveStateSerializer;
 
 template <typename Frequency>
 class DAC {
@@ -36,6 +37,9 @@ public:
   void set_frequency_low(uint8_t value);
   void set_frequency_high(uint8_t value);
 
+  void serialize(SaveStateSerializer& serializer) const;
+  void deserialize(SaveStateSerializer& serializer);
+
 private:
   float enabled_ = CHANNEL_DISABLED;
   Frequency duty_;
@@ -63,6 +67,9 @@ public:
   void disable_wave_ram();
   uint16_t get_timer_counter() const;
 
+  void serialize(SaveStateSerializer& serializer) const;
+  void deserialize(SaveStateSerializer& serializer);
+
 private:
   float enabled_ = CHANNEL_DISABLED;
   WaveRAM wave_ram_;
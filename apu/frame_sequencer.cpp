@@ -1,6 +1,7 @@
 #include "frame_sequencer.h"
 #include "envelope.h"
 #include "length_timer.h"
+#include "save_state.h"
 #include "sweep.h"
 
 void FrameSequencer::reset() {
@@ -51,4 +52,12 @@ void FrameSequencer::add_sweep(Sweep* sweep) {
 
 bool FrameSequencer::next_step_is_length_counter() const {
   return step_ % 2 == 0;
-}
\ No newline at end of file
+}
+
+void FrameSequencer::serialize(SaveStateSerializer& serializer) const {
+  serializer << step_;
+}
+
+void FrameSequencer::deserialize(SaveStateSerializer& serializer) {
+  serializer >> step_;
+}
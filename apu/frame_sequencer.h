@@ -7,6 +7,7 @@
 class Envelope;
 
 class Sweep;
+class SaveStateSerializer;
 
 class FrameSequencer {
 public:
@@ -28,6 +29,10 @@ public:
   }
   void add_sweep(Sweep* sweep);
 
+  // Only the step is state; the registered components are wired up by their constructors
+  void serialize(SaveStateSerializer& serializer) const;
+  void deserialize(SaveStateSerializer& serializer);
+
 private:
   template <typename T>
   void run_step(const T& v);
@@ -1,5 +1,6 @@
 #include "mixer.h"
 #include "audio_constants.h"
+#include "save_state.h"
 
 Mixer::Mixer(FrameSequencer& frame_sequencer, AudioRegisters& audio_registers)
     : channel1_(frame_sequencer, audio_registers),
@@ -28,4 +29,22 @@ void Mixer::master_enable() {
 
 const WaveChannel& Mixer::channel3() const {
   return channel3_;
-}
\ No newline at end of file
+}
+
+void Mixer::serialize(SaveStateSerializer& serializer) const {
+  channel1_.serialize(serializer);
+  channel2_.serialize(serializer);
+  channel3_.serialize(serializer);
+  channel4_.serialize(serializer);
+  serializer << left_volume_;
+  serializer << right_volume_;
+}
+
+void Mixer::deserialize(SaveStateSerializer& serializer) {
+  channel1_.deserialize(serializer);
+  channel2_.deserialize(serializer);
+  channel3_.deserialize(serializer);
+  channel4_.deserialize(serializer);
+  serializer >> left_volume_;
+  serializer >> right_volume_;
+}
@@ -18,6 +18,9 @@ public:
   void master_enable();
   const WaveChannel& channel3() const;
 
+  void serialize(SaveStateSerializer& serializer) const;
+  void deserialize(SaveStateSerializer& serializer);
+
   std::pair<float, float> output() const {
     const auto [left1, right1] = channel1_.output();
     const auto [left2, right2] = channel2_.output();
@@ -4,6 +4,7 @@
 #include "channel_traits.h"
 #include "frame_sequencer.h"
 #include "length_timer.h"
+#include "save_state.h"
 
 template <typename Traits>
 SquareWaveChannel<Traits>::SquareWaveChannel(FrameSequencer& frame_sequencer, AudioRegisters& audio_registers)
@@ -75,6 +76,18 @@ void SquareWaveChannel<Traits>::audio_register_write(uint16_t address, uint8_t v
   }
 }
 
+template <typename Traits>
+void SquareWaveChannel<Traits>::serialize(SaveStateSerializer& serializer) const {
+  ChannelBase<SquareWaveChannel<Traits>, Traits>::serialize(serializer);
+  sweep_.serialize(serializer);
+}
+
+template <typename Traits>
+void SquareWaveChannel<Traits>::deserialize(SaveStateSerializer& serializer) {
+  ChannelBase<SquareWaveChannel<Traits>, Traits>::deserialize(serializer);
+  sweep_.deserialize(serializer);
+}
+
 // Explicit template instantiations
 template class SquareWaveChannel<Channel1Traits>;
 template class SquareWaveChannel<Channel2Traits>;
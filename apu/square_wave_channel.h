@@ -15,6 +15,9 @@ public:
 
   void audio_register_write(uint16_t address, uint8_t value);
 
+  void serialize(SaveStateSerializer& serializer) const;
+  void deserialize(SaveStateSerializer& serializer);
+
 private:
   using ChannelBase<SquareWaveChannel<Traits>, Traits>::disable_channel;
   using ChannelBase<SquareWaveChannel<Traits>, Traits>::enable_channel;
@@ -0,0 +1,101 @@
+#include <inttypes.h>
+#include <chrono>
+#include <iostream>
+#include <string>
+#include <thread>
+#include <vector>
+#include "emulation_thread.h"
+#include "frame_jitter.h"
+#include "joypad_state.h"
+#include "rom_loader.h"
+
+// Runs the emulation thread against a presenter that keeps up, and then against one that stalls for a long present
+// every few frames and floods the input queue in between. Emulation should keep its pace either way, only dropping
+// frames the presenter never took. Frame time jitter is printed for both threads as they go.
+
+using namespace std::chrono;
+
+namespace {
+constexpr int DEFAULT_SECONDS = 10;
+constexpr double FRAMES_PER_SECOND = 59.73;
+constexpr uint32_t JITTER_REPORT_FRAMES = 300;
+constexpr milliseconds FRAME_POLL_INTERVAL(1);
+constexpr uint32_t STALL_EVERY_FRAMES = 20;
+constexpr milliseconds STALL_DURATION(100);
+constexpr int STORM_INPUTS = 1000;  // Input changes sent each time the stalling presenter polls
+constexpr size_t AUDIO_CHUNK_SAMPLES = 8192;
+
+// Returns false if frames came out of order
+bool run_presenter(EmulationThread& emulation, const std::string& name, int seconds, bool stall) {
+  FrameJitter jitter(name, JITTER_REPORT_FRAMES);
+  std::vector<int16_t> audio(AUDIO_CHUNK_SAMPLES);
+  JoypadState joypad;
+  uint64_t first_number = 0;
+  uint64_t last_number = 0;
+  uint64_t frames_taken = 0;
+  size_t samples_taken = 0;
+
+  const auto start = steady_clock::now();
+  const auto end = start + std::chrono::seconds(seconds);
+  while (steady_clock::now() < end) {
+    if (stall) {
+      for (int i = 0; i < STORM_INPUTS; i++) {
+        joypad.select_pressed = !joypad.select_pressed;
+        emulation.set_input(joypad, false);
+      }
+    }
+
+    const EmulationThread::Frame* frame = emulation.take_frame();
+    if (frame == nullptr) {
+      std::this_thread::sleep_for(FRAME_POLL_INTERVAL);
+      continue;
+    }
+    if (frames_taken > 0 && frame->number <= last_number) {
+      std::cerr << name << ": frame " << frame->number << " came after " << last_number << std::endl;
+      return false;
+    }
+    if (frames_taken == 0) {
+      first_number = frame->number;
+    }
+    last_number = frame->number;
+    frames_taken++;
+    for (size_t taken = emulation.take_audio(audio.data(), audio.size()); taken > 0;
+         taken = emulation.take_audio(audio.data(), audio.size())) {
+      samples_taken += taken;
+    }
+    jitter.record(steady_clock::now());
+
+    if (stall && frames_taken % STALL_EVERY_FRAMES == 0) {
+      std::this_thread::sleep_for(STALL_DURATION);
+    }
+  }
+
+  const double elapsed = duration<double>(steady_clock::now() - start).count();
+  const uint64_t emulated = last_number - first_number + 1;
+  std::cout << name << ": " << emulated / elapsed / FRAMES_PER_SECOND << "x speed emulated, " << frames_taken
+            << " of " << emulated << " frames presented, " << samples_taken / elapsed << " samples per second"
+            << std::endl;
+  return true;
+}
+}  // namespace
+
+int main(int argc, char** argv) {
+  if (argc < 2) {
+    std::cerr << "Usage: bench_emulation_thread Rom [seconds per presenter]" << std::endl;
+    return -1;
+  }
+  const int seconds = argc > 2 ? std::stoi(argv[2]) : DEFAULT_SECONDS;
+
+  ROMLoader loader(argv[1]);
+  if (!loader.load()) {
+    return -1;
+  }
+
+  EmulationThread emulation(loader);
+  emulation.start();
+  if (!run_presenter(emulation, "Steady presenter", seconds, false) ||
+      !run_presenter(emulation, "Stalling presenter", seconds, true)) {
+    return 1;
+  }
+  return 0;
+}
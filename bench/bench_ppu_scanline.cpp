@@ -0,0 +1,515 @@
+#include <inttypes.h>
+#include <algorithm>
+#include <array>
+#include <chrono>
+#include <cstring>
+#include <functional>
+#include <iostream>
+#include <memory>
+#include <random>
+#include <vector>
+#include "fifo_renderer.h"
+#include "game_screen.h"
+#include "object_attributes.h"
+#include "object_line.h"
+#include "palette.h"
+#include "ppu_constants.h"
+#include "ppu_memory.h"
+#include "ppu_registers.h"
+#include "scanline_renderer.h"
+#include "tile_row.h"
+
+// Scanline rendering cost in ns/scanline, against the original pixel by pixel renderer: the background/window tile row
+// renderer reading PPUMemory's decoded tiles, with and without its SIMD palette step, copies out of the tile map
+// bitmaps the PPU uses, and whole scanlines drawn in shades the way the PPU does, with objects drawn as spans and
+// composited in one pass. Also what converting a frame of shades to ARGB and redrawing both tile maps when LCDC
+// switches tile data addressing cost, and finding the lines of a frame that changed. Random VRAM, OAM and registers, so
+// every output is also checked against the per-pixel one. Last, ScanlineRenderer from snapshots, with and without
+// register writes splitting each line, checked against unsplit lines drawn with each span's registers, and FifoRenderer
+// stepping each line dot by dot, checked against ScanlineRenderer.
+
+using namespace std::chrono;
+
+namespace {
+constexpr int SCENES = 64;
+constexpr int FRAMES_PER_SCENE = 50;
+constexpr uint32_t LINE_SLACK = TILE_WIDTH;
+
+struct Scene {
+  std::unique_ptr<PPUMemory> memory;  // VRAM, decoded tiles, tile map bitmaps and OAM
+  std::array<std::array<ObjectAttribute*, MAX_SPRITES_PER_SCANLINE>, SCREEN_HEIGHT> objects;
+  uint8_t lcdc;
+  uint8_t scx;
+  uint8_t scy;
+  uint8_t wx;
+  uint8_t wy;
+  std::array<uint8_t, 4> shades;          // As Palette::shades(BGP)
+  std::array<uint8_t, 8> object_shades;   // As Palette::object_shades
+  std::array<RGBValue, 4> colors;         // The same as ARGB, for renderers that skip the shades
+  std::array<uint32_t, 8> object_colors;
+};
+
+struct Line {
+  std::array<uint8_t, SCREEN_WIDTH + 2 * LINE_SLACK> indices;
+  std::array<uint32_t, SCREEN_WIDTH> argb;
+};
+
+using Renderer = std::function<void(const Scene&, uint8_t scanline, uint8_t window_y)>;
+
+bool window_on(const Scene& scene, uint8_t scanline) {
+  return (scene.lcdc & LCDC_WINDOW_ENABLE) && scanline >= scene.wy;
+}
+
+uint32_t window_start(const Scene& scene, uint8_t scanline) {
+  if (!window_on(scene, scanline)) {
+    return SCREEN_WIDTH;
+  }
+  return std::min<uint32_t>(std::max(scene.wx, WINDOW_X_OFFSET) - WINDOW_X_OFFSET, SCREEN_WIDTH);
+}
+
+uint8_t colour_index(const Scene& scene, uint32_t tile, uint32_t x, uint32_t y) {
+  const uint8_t* row = &scene.memory->vram()[tile * TILE_SIZE_BYTES + y * TileRow::BYTES_PER_TILE_ROW];
+  const uint8_t bit = 7 - x;
+  return ((row[0] >> bit) & 1) | ((row[1] >> bit) & 1) << 1;
+}
+
+// The background renderer this replaced, one tile map lookup and bit extraction per pixel
+void render_background_per_pixel(const Scene& scene, uint8_t scanline, uint8_t window_y, Line& line) {
+  const bool window = window_on(scene, scanline);
+  for (uint32_t x = 0; x < SCREEN_WIDTH; x++) {
+    uint8_t map_x, map_y;
+    uint16_t tile_map_base;
+    if (window && x + WINDOW_X_OFFSET >= scene.wx) {
+      map_x = x + WINDOW_X_OFFSET - scene.wx;
+      map_y = window_y;
+      tile_map_base = (scene.lcdc & LCDC_WINDOW_TILE_MAP) ? TILE_MAP_BASE_1 : TILE_MAP_BASE_0;
+    } else {
+      map_x = x + scene.scx;
+      map_y = scanline + scene.scy;
+      tile_map_base = (scene.lcdc & LCDC_BG_TILE_MAP) ? TILE_MAP_BASE_1 : TILE_MAP_BASE_0;
+    }
+    const uint16_t map_address = tile_map_base + (map_y / TILE_HEIGHT) * TILES_PER_ROW + map_x / TILE_WIDTH;
+    const uint8_t tile_index = scene.memory->vram()[map_address - VRAM_BASE_ADDRESS];
+    const uint32_t tile = TileRow::bgwin_tile(tile_index, scene.lcdc & LCDC_TILE_DATA);
+    const uint8_t index = colour_index(scene, tile, map_x % TILE_WIDTH, map_y % TILE_HEIGHT);
+    line.indices[LINE_SLACK + x] = index;
+    line.argb[x] = scene.colors[index].argb;
+  }
+}
+
+// The object renderer this replaced, checking every object against every pixel
+void render_objects_per_pixel(const Scene& scene, uint8_t scanline, Line& line) {
+  if ((scene.lcdc & LCDC_SPRITE_ENABLE) == 0) {
+    return;
+  }
+  const bool big_tile_mode = (scene.lcdc & LCDC_SPRITE_SIZE) != 0;
+  for (int32_t x = 0; x < static_cast<int32_t>(SCREEN_WIDTH); x++) {
+    for (const ObjectAttribute* object : scene.objects[scanline]) {
+      if (object == nullptr)
+        break;
+      const int32_t left = object->x - SPRITE_X_OFFSET;
+      if (x < left || x >= object->x)
+        continue;
+
+      uint32_t pixel_x = x - left;
+      uint32_t pixel_y = scanline - (object->y - SPRITE_Y_OFFSET);
+      if (object->flip_x())
+        pixel_x = 7 - pixel_x;
+      if (object->flip_y())
+        pixel_y = (big_tile_mode ? SPRITE_HEIGHT_8X16 : SPRITE_HEIGHT_8X8) - pixel_y;
+      uint8_t tile = object->index;
+      if (big_tile_mode) {
+        tile = (tile & 0xFE) | (pixel_y >= TILE_HEIGHT);
+        pixel_y %= TILE_HEIGHT;
+      }
+
+      const uint8_t index = colour_index(scene, tile, pixel_x, pixel_y);
+      if (index == 0)
+        continue;
+      if (!object->priority() || line.indices[LINE_SLACK + x] == 0)
+        line.argb[x] = scene.object_colors[index + (object->dmg_palette_obp1() ? 4 : 0)];
+      break;
+    }
+  }
+}
+
+void render_background_tile_rows(const Scene& scene, uint8_t scanline, uint8_t window_y, Line& line, bool simd) {
+  uint8_t* indices = line.indices.data() + LINE_SLACK;
+  TileRow::fetch_line(scene.memory->vram().data(), scene.memory->decoded_tiles(), scene.lcdc, scene.scx,
+                      scanline + scene.scy, window_start(scene, scanline), scene.wx, window_y, indices);
+  if (simd) {
+    TileRow::apply_palette(indices, scene.colors, line.argb.data(), SCREEN_WIDTH);
+  } else {
+    TileRow::apply_palette_scalar(indices, scene.colors, line.argb.data(), SCREEN_WIDTH);
+  }
+}
+
+void render_background_map_bitmaps(const Scene& scene, uint8_t scanline, uint8_t window_y, Line& line) {
+  uint8_t* indices = line.indices.data() + LINE_SLACK;
+  scene.memory->tile_maps().fetch_line(scene.lcdc, scene.scx, scanline + scene.scy, window_start(scene, scanline),
+                                       scene.wx, window_y, indices);
+  TileRow::apply_palette(indices, scene.colors, line.argb.data(), SCREEN_WIDTH);
+}
+
+uint8_t palette_register(const uint8_t* shades) {
+  return shades[0] | shades[1] << 2 | shades[2] << 4 | shades[3] << 6;
+}
+
+// What the PPU hands ScanlineRenderer for a line of the scene
+LineSnapshot snapshot(const Scene& scene, uint8_t scanline, uint8_t window_y) {
+  LineSnapshot line = {};
+  for (uint32_t i = 0; (scene.lcdc & LCDC_SPRITE_ENABLE) && i < MAX_SPRITES_PER_SCANLINE; i++) {
+    if (scene.objects[scanline][i] == nullptr)
+      break;
+    line.objects[line.object_count++] = *scene.objects[scanline][i];
+  }
+  line.scanline = scanline;
+  line.lcdc = scene.lcdc;
+  line.scx = scene.scx;
+  line.scy = scene.scy;
+  line.wx = scene.wx;
+  line.bgp = palette_register(scene.shades.data());
+  line.obp0 = palette_register(scene.object_shades.data());
+  line.obp1 = palette_register(scene.object_shades.data() + 4);
+  line.window_line = window_y;
+  line.window_visible = window_on(scene, scanline);
+  return line;
+}
+
+// A raster effect's worth of writes: scrolling, switching tile data and map halfway, then palettes
+LineSnapshot split_snapshot(const Scene& scene, uint8_t scanline, uint8_t window_y) {
+  LineSnapshot line = snapshot(scene, scanline, window_y);
+  const std::array<RegisterChange, 4> changes = {{
+      {40, REGISTER_OFFSET_SCX, static_cast<uint8_t>(line.scx + 37)},
+      {80, REGISTER_OFFSET_LCDC, static_cast<uint8_t>(line.lcdc ^ (LCDC_TILE_DATA | LCDC_BG_TILE_MAP))},
+      {123, REGISTER_OFFSET_BGP, static_cast<uint8_t>(~line.bgp)},
+      {123, REGISTER_OFFSET_OBP0, static_cast<uint8_t>(~line.obp0)},
+  }};
+  std::copy(changes.begin(), changes.end(), line.changes.begin());
+  line.change_count = changes.size();
+  return line;
+}
+
+// The scene's registers, for renderers that read them as the line goes
+PPURegisters registers(const Scene& scene) {
+  const LineSnapshot line = snapshot(scene, 0, 0);
+  PPURegisters registers(false);
+  registers.write_register(PPU_REGISTER_START + REGISTER_OFFSET_LCDC, line.lcdc);
+  registers.write_register(PPU_REGISTER_START + REGISTER_OFFSET_SCX, line.scx);
+  registers.write_register(PPU_REGISTER_START + REGISTER_OFFSET_SCY, line.scy);
+  registers.write_register(PPU_REGISTER_START + REGISTER_OFFSET_WX, line.wx);
+  registers.write_register(PPU_REGISTER_START + REGISTER_OFFSET_WY, scene.wy);
+  registers.write_register(PPU_REGISTER_START + REGISTER_OFFSET_BGP, line.bgp);
+  registers.write_register(PPU_REGISTER_START + REGISTER_OFFSET_OBP0, line.obp0);
+  registers.write_register(PPU_REGISTER_START + REGISTER_OFFSET_OBP1, line.obp1);
+  return registers;
+}
+
+// Mode 3 of a line the way the PPU steps FifoRenderer through it
+void render_fifo(FifoRenderer& renderer, const PPURegisters& registers, const LineSnapshot& line) {
+  renderer.start_line(line, true);
+  while (!renderer.line_done()) {
+    renderer.step(registers);
+  }
+}
+
+// A whole scanline the way the PPU draws it
+void render_scanline(const Scene& scene, uint8_t scanline, uint8_t window_y, GameScreen& screen) {
+  Line line;
+  uint8_t* indices = line.indices.data() + LINE_SLACK;
+  scene.memory->tile_maps().fetch_line(scene.lcdc, scene.scx, scanline + scene.scy, window_start(scene, scanline),
+                                       scene.wx, window_y, indices);
+  screen.draw_background_line(scanline, indices, scene.shades);
+
+  if ((scene.lcdc & LCDC_SPRITE_ENABLE) && scene.objects[scanline][0] != nullptr) {
+    ObjectLine::Buffer objects = {};
+    ObjectLine::draw_objects(objects, scene.objects[scanline], scanline, scene.lcdc & LCDC_SPRITE_SIZE,
+                             scene.memory->decoded_tiles(), scene.memory->flipped_tiles());
+    screen.draw_object_line(scanline, objects.data() + ObjectLine::SLACK, scene.object_shades);
+  }
+}
+
+std::vector<Scene> make_scenes() {
+  std::mt19937 random(1);
+  static PPURegisters registers(false);  // Outside modes 2 and 3, so OAM is writable
+  std::vector<Scene> scenes(SCENES);
+  for (Scene& scene : scenes) {
+    scene.lcdc = static_cast<uint8_t>(random()) | LCDC_DISPLAY_ENABLE | LCDC_BG_ENABLE;
+    scene.memory = std::make_unique<PPUMemory>(registers);
+    for (uint32_t i = 0; i < VRAM_SIZE; i++) {
+      scene.memory->write_vram(VRAM_BASE_ADDRESS + i, static_cast<uint8_t>(random()));
+    }
+    scene.memory->refresh_decoded_vram(scene.lcdc & LCDC_TILE_DATA);
+
+    scene.scx = static_cast<uint8_t>(random());
+    scene.scy = static_cast<uint8_t>(random());
+    scene.wx = static_cast<uint8_t>(random() % 176);
+    scene.wy = static_cast<uint8_t>(random() % 160);
+    for (uint32_t i = 0; i < scene.shades.size(); i++) {
+      scene.shades[i] = random() % 4;
+      scene.colors[i] = GameBoyColors::SHADES[scene.shades[i]];
+    }
+    for (uint32_t i = 0; i < scene.object_shades.size(); i++) {
+      scene.object_shades[i] = random() % 4;
+      scene.object_colors[i] = GameBoyColors::SHADES[scene.object_shades[i]].argb;
+    }
+
+    // Objects on screen, or hanging just off an edge
+    for (uint16_t address = OAM_BASE_ADDRESS; address <= OAM_END_ADDRESS; address += 4) {
+      scene.memory->write_oam(address, static_cast<uint8_t>(random() % (SCREEN_HEIGHT + SPRITE_Y_OFFSET)));
+      scene.memory->write_oam(address + 1, static_cast<uint8_t>(random() % (SCREEN_WIDTH + 2 * SPRITE_X_OFFSET)));
+      scene.memory->write_oam(address + 2, static_cast<uint8_t>(random()));
+      scene.memory->write_oam(address + 3, static_cast<uint8_t>(random()));
+    }
+    ObjectAttributes attributes(*scene.memory);
+    for (uint8_t scanline = 0; scanline < SCREEN_HEIGHT; scanline++) {
+      scene.objects[scanline] = attributes.get_objects_for_scanline(scanline, scene.lcdc & LCDC_SPRITE_SIZE);
+    }
+  }
+  return scenes;
+}
+
+// Renders every scene's frame FRAMES_PER_SCENE times and reports the fastest frame per scanline
+void report(const std::string& name, const std::vector<Scene>& scenes, const Renderer& render) {
+  double best = 1e30;
+  for (int frame = 0; frame < FRAMES_PER_SCENE; frame++) {
+    for (const Scene& scene : scenes) {
+      uint8_t window_y = 0;
+      auto start = steady_clock::now();
+      for (uint8_t scanline = 0; scanline < SCREEN_HEIGHT; scanline++) {
+        render(scene, scanline, window_y);
+        window_y += window_on(scene, scanline) && scene.wx < WINDOW_MAX_X;
+      }
+      best = std::min(best, duration<double, std::nano>(steady_clock::now() - start).count());
+    }
+  }
+  std::cout << name << ": " << best / SCREEN_HEIGHT << "ns/scanline" << std::endl;
+}
+
+// Draws every scene's frame in shades and times converting it to ARGB, as happens once per frame presented: into
+// GameScreen's own buffer and copied out to the frontend's, or straight into the frontend's. Both must agree.
+bool report_present(const std::vector<Scene>& scenes, GameScreen& screen) {
+  std::vector<uint32_t> copied(SCREEN_WIDTH * SCREEN_HEIGHT);
+  std::vector<uint32_t> converted(SCREEN_WIDTH * SCREEN_HEIGHT);
+  double best_copied = 1e30;
+  double best_converted = 1e30;
+  for (int frame = 0; frame < FRAMES_PER_SCENE; frame++) {
+    for (const Scene& scene : scenes) {
+      for (uint8_t scanline = 0; scanline < SCREEN_HEIGHT; scanline++) {
+        render_scanline(scene, scanline, scanline, screen);
+      }
+      auto start = steady_clock::now();
+      memcpy(copied.data(), screen.pixel_data(), copied.size() * sizeof(uint32_t));
+      best_copied = std::min(best_copied, duration<double, std::micro>(steady_clock::now() - start).count());
+
+      start = steady_clock::now();
+      screen.convert_lines({0, SCREEN_HEIGHT}, converted.data(), screen.pitch());
+      best_converted = std::min(best_converted, duration<double, std::micro>(steady_clock::now() - start).count());
+      if (copied != converted) {
+        std::cerr << "Frame converted in place differs from the copy" << std::endl;
+        return false;
+      }
+    }
+  }
+  std::cout << "Frame shades to ARGB, then copied: " << best_copied << "us" << std::endl;
+  std::cout << "Frame shades to ARGB in place: " << best_converted << "us" << std::endl;
+  return true;
+}
+
+// Draws every scene's frame twice over and times finding what changed the second time, which is every scanline
+// compared and none found changed. Then changes one line and checks that only it is, and that it is again after
+// being handed back unshown.
+bool report_changed_lines(const std::vector<Scene>& scenes, GameScreen& screen) {
+  double best = 1e30;
+  for (int frame = 0; frame < FRAMES_PER_SCENE; frame++) {
+    for (const Scene& scene : scenes) {
+      for (int pass = 0; pass < 2; pass++) {
+        for (uint8_t scanline = 0; scanline < SCREEN_HEIGHT; scanline++) {
+          render_scanline(scene, scanline, scanline, screen);
+        }
+        auto start = steady_clock::now();
+        const GameScreen::LineRange changed = screen.take_changed_lines();
+        if (pass == 1) {
+          best = std::min(best, duration<double, std::micro>(steady_clock::now() - start).count());
+          if (!changed.empty()) {
+            std::cerr << "Redrawn frame reported changed" << std::endl;
+            return false;
+          }
+        }
+      }
+    }
+  }
+  std::cout << "Changed lines of a redrawn frame: " << best << "us" << std::endl;
+
+  const std::array<uint8_t, SCREEN_WIDTH> line = {};
+  const std::array<uint8_t, 4> black = {3, 3, 3, 3};
+  screen.draw_background_line(100, line.data(), black);
+  for (int attempt = 0; attempt < 2; attempt++) {
+    const GameScreen::LineRange changed = screen.take_changed_lines();
+    if (changed.first != 100 || changed.end != 101) {
+      std::cerr << "Changed lines " << changed.first << " to " << changed.end << " for a single line" << std::endl;
+      return false;
+    }
+    screen.restore_changed_lines(changed);
+  }
+  return true;
+}
+
+// Flips every scene's tile data addressing and back, timing the redraw of both tile maps each flip causes
+void report_full_redraw(std::vector<Scene>& scenes) {
+  double best = 1e30;
+  for (int flip = 0; flip < 2 * FRAMES_PER_SCENE; flip++) {
+    for (Scene& scene : scenes) {
+      auto start = steady_clock::now();
+      scene.memory->refresh_decoded_vram(!(scene.lcdc & LCDC_TILE_DATA));
+      best = std::min(best, duration<double, std::micro>(steady_clock::now() - start).count());
+      scene.memory->refresh_decoded_vram(scene.lcdc & LCDC_TILE_DATA);
+    }
+  }
+  std::cout << "Tile map full redraw: " << best << "us" << std::endl;
+}
+
+// Every split line against unsplit lines drawn with each span's registers
+bool check_split(const std::vector<Scene>& scenes, GameScreen& screen) {
+  for (const Scene& scene : scenes) {
+    ScanlineRenderer renderer(*scene.memory, screen);
+    for (uint8_t scanline = 0; scanline < SCREEN_HEIGHT; scanline++) {
+      const LineSnapshot split = split_snapshot(scene, scanline, scanline);
+      renderer.draw(split);
+      const uint8_t* row = screen.shade_data() + scanline * screen.shade_pitch();
+      const std::vector<uint8_t> actual(row, row + SCREEN_WIDTH);
+
+      LineSnapshot span = split;
+      span.change_count = 0;
+      for (uint32_t i = 0; i <= split.change_count; i++) {
+        const uint32_t x = i == 0 ? 0 : split.changes[i - 1].x;
+        const uint32_t end = i < split.change_count ? split.changes[i].x : SCREEN_WIDTH;
+        renderer.draw(span);
+        if (!std::equal(row + x, row + end, actual.begin() + x)) {
+          std::cerr << "Split line mismatch on scanline " << static_cast<int>(scanline) << " from x " << x
+                    << std::endl;
+          return false;
+        }
+        if (i < split.change_count) {
+          const RegisterChange& change = split.changes[i];
+          span.scx = change.offset == REGISTER_OFFSET_SCX ? change.value : span.scx;
+          span.lcdc = change.offset == REGISTER_OFFSET_LCDC ? change.value : span.lcdc;
+          span.bgp = change.offset == REGISTER_OFFSET_BGP ? change.value : span.bgp;
+          span.obp0 = change.offset == REGISTER_OFFSET_OBP0 ? change.value : span.obp0;
+        }
+      }
+    }
+  }
+  return true;
+}
+
+// Every line of every scene dot by dot against ScanlineRenderer
+bool check_fifo(const std::vector<Scene>& scenes, GameScreen& screen) {
+  for (const Scene& scene : scenes) {
+    const PPURegisters scene_registers = registers(scene);
+    FifoRenderer fifo(*scene.memory, screen);
+    uint8_t window_y = 0;
+    for (uint8_t scanline = 0; scanline < SCREEN_HEIGHT; scanline++) {
+      const LineSnapshot line = snapshot(scene, scanline, window_y);
+      window_y += window_on(scene, scanline) && scene.wx < WINDOW_MAX_X;
+      ScanlineRenderer(*scene.memory, screen).draw(line);
+      const uint8_t* row = screen.shade_data() + scanline * screen.shade_pitch();
+      const std::vector<uint8_t> expected(row, row + SCREEN_WIDTH);
+      render_fifo(fifo, scene_registers, line);
+      if (!std::equal(expected.begin(), expected.end(), row)) {
+        std::cerr << "FIFO mismatch on scanline " << static_cast<int>(scanline) << " with SCX "
+                  << static_cast<int>(scene.scx) << ", WX " << static_cast<int>(scene.wx) << std::endl;
+        return false;
+      }
+    }
+  }
+  return true;
+}
+
+// Every line of every scene against the per-pixel renderers
+bool check(const std::vector<Scene>& scenes, GameScreen& screen) {
+  for (const Scene& scene : scenes) {
+    for (uint8_t scanline = 0; scanline < SCREEN_HEIGHT; scanline++) {
+      Line expected = {};
+      render_background_per_pixel(scene, scanline, scanline, expected);
+      for (int renderer = 0; renderer < 3; renderer++) {
+        Line actual = {};
+        if (renderer < 2) {
+          render_background_tile_rows(scene, scanline, scanline, actual, renderer == 1);
+        } else {
+          render_background_map_bitmaps(scene, scanline, scanline, actual);
+        }
+        if (!std::equal(expected.indices.begin() + LINE_SLACK, expected.indices.end() - LINE_SLACK,
+                        actual.indices.begin() + LINE_SLACK) ||
+            expected.argb != actual.argb) {
+          std::cerr << "Background mismatch on scanline " << static_cast<int>(scanline) << " with SCX "
+                    << static_cast<int>(scene.scx) << ", WX " << static_cast<int>(scene.wx) << std::endl;
+          return false;
+        }
+      }
+
+      render_objects_per_pixel(scene, scanline, expected);
+      render_scanline(scene, scanline, scanline, screen);
+      if (!std::equal(expected.argb.begin(), expected.argb.end(), screen.pixel_data() + scanline * SCREEN_WIDTH)) {
+        std::cerr << "Object mismatch on scanline " << static_cast<int>(scanline) << std::endl;
+        return false;
+      }
+    }
+  }
+  return true;
+}
+}  // namespace
+
+int main() {
+  std::vector<Scene> scenes = make_scenes();
+  GameScreen screen;
+  if (!check(scenes, screen) || !check_split(scenes, screen) || !check_fifo(scenes, screen)) {
+    return 1;
+  }
+
+  Line line = {};
+  report("Background per pixel", scenes, [&](const Scene& scene, uint8_t scanline, uint8_t window_y) {
+    render_background_per_pixel(scene, scanline, window_y, line);
+  });
+  report("Background tile rows, scalar palette", scenes,
+         [&](const Scene& scene, uint8_t scanline, uint8_t window_y) {
+           render_background_tile_rows(scene, scanline, window_y, line, false);
+         });
+#ifdef __SSE2__
+  report("Background tile rows, SSE2 palette", scenes, [&](const Scene& scene, uint8_t scanline, uint8_t window_y) {
+    render_background_tile_rows(scene, scanline, window_y, line, true);
+  });
+#endif
+  report("Background map bitmaps", scenes, [&](const Scene& scene, uint8_t scanline, uint8_t window_y) {
+    render_background_map_bitmaps(scene, scanline, window_y, line);
+  });
+  report("Background and objects per pixel", scenes, [&](const Scene& scene, uint8_t scanline, uint8_t window_y) {
+    render_background_per_pixel(scene, scanline, window_y, line);
+    render_objects_per_pixel(scene, scanline, line);
+  });
+  report("Background map bitmaps and object spans, in shades", scenes,
+         [&](const Scene& scene, uint8_t scanline, uint8_t window_y) {
+           render_scanline(scene, scanline, window_y, screen);
+         });
+  report("ScanlineRenderer, no register changes", scenes,
+         [&](const Scene& scene, uint8_t scanline, uint8_t window_y) {
+           ScanlineRenderer(*scene.memory, screen).draw(snapshot(scene, scanline, window_y));
+         });
+  report("ScanlineRenderer, 4 register changes a line", scenes,
+         [&](const Scene& scene, uint8_t scanline, uint8_t window_y) {
+           ScanlineRenderer(*scene.memory, screen).draw(split_snapshot(scene, scanline, window_y));
+         });
+  std::vector<PPURegisters> scene_registers;
+  for (const Scene& scene : scenes) {
+    scene_registers.push_back(registers(scene));
+  }
+  report("FifoRenderer, dot by dot", scenes, [&](const Scene& scene, uint8_t scanline, uint8_t window_y) {
+    FifoRenderer fifo(*scene.memory, screen);
+    render_fifo(fifo, scene_registers[&scene - scenes.data()], snapshot(scene, scanline, window_y));
+  });
+  if (!report_present(scenes, screen) || !report_changed_lines(scenes, screen)) {
+    return 1;
+  }
+  report_full_redraw(scenes);
+  return 0;
+}
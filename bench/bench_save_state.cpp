@@ -0,0 +1,85 @@
+#include <inttypes.h>
+#include <algorithm>
+#include <chrono>
+#include <functional>
+#include <iostream>
+#include <vector>
+#include "main_loop.h"
+#include "rom_loader.h"
+#include "save_state.h"
+#include "save_state_file.h"
+
+// Measures save and load latency of a full machine state, both as an in-memory snapshot (rewind, run-ahead)
+// and as a complete sectioned save state file built in memory.
+
+using namespace std::chrono;
+
+namespace {
+constexpr int DEFAULT_WARMUP_FRAMES = 120;
+constexpr int ITERATIONS = 200;
+
+void report(const std::string& name, const std::function<void()>& fn) {
+  std::vector<double> samples;
+  samples.reserve(ITERATIONS);
+  for (int i = 0; i < ITERATIONS; i++) {
+    auto start = steady_clock::now();
+    fn();
+    samples.push_back(duration<double, std::micro>(steady_clock::now() - start).count());
+  }
+  std::sort(samples.begin(), samples.end());
+  std::cout << name << ": min " << samples.front() << "us, median " << samples[samples.size() / 2] << "us"
+            << std::endl;
+}
+}  // namespace
+
+int main(int argc, char** argv) {
+  if (argc < 2) {
+    std::cerr << "Usage: bench_save_state Rom [warmup frames]" << std::endl;
+    return -1;
+  }
+  int warmup_frames = argc > 2 ? std::stoi(argv[2]) : DEFAULT_WARMUP_FRAMES;
+
+  ROMLoader loader(argv[1]);
+  if (!loader.load()) {
+    return -1;
+  }
+
+  int frames = 0;
+  OSBridge bridge;
+  bridge.blit_screen = [&](const uint32_t* pixels, size_t pitch) { frames++; };
+  bridge.present_frame = []() {};
+  bridge.handle_events = [](JoypadState& joypad_state) { return false; };
+  bridge.on_audio_generated = [](const int16_t* samples, int num_samples) {};
+  MainLoop loop(loader, bridge);
+  while (frames < warmup_frames) {
+    loop.run_once();
+  }
+
+  std::vector<uint8_t> snapshot;
+  report("Snapshot save", [&]() {
+    SaveStateSerializer serializer(snapshot, false, true);
+    loop.serialize(serializer);
+  });
+  report("Snapshot load", [&]() {
+    SaveStateSerializer serializer(snapshot, true, true);
+    loop.deserialize(serializer);
+  });
+
+  std::vector<uint8_t> file;
+  for (bool compress : {true, false}) {
+    std::string suffix = compress ? " (compressed)" : " (uncompressed)";
+    report("File save" + suffix, [&]() {
+      SaveStateWriter writer(compress);
+      loop.save_sections(writer);
+      writer.write_to(file);
+    });
+    report("File load" + suffix, [&]() {
+      SaveStateReader reader(file);
+      loop.load_sections(reader);
+    });
+  }
+
+  std::cout << "Snapshot size: " << snapshot.size() << " bytes, file size: " << file.size() << " bytes"
+            << std::endl;
+  return 0;
+}
@@ -0,0 +1,103 @@
+#include <inttypes.h>
+#include <algorithm>
+#include <chrono>
+#include <iostream>
+#include <random>
+#include <string>
+#include <thread>
+#include <vector>
+#include "upscaler.h"
+
+// Per-frame cost of scaling a Game Boy frame up to the window, for each filter at 4x, 8x and 12x, on one thread and
+// on the default number. The frame is random tiles of the four DMG shades with diagonal edges for the smoothing
+// rules to find. Every output is checked against the single threaded one, and Nearest against a plain copy.
+
+using namespace std::chrono;
+
+namespace {
+constexpr uint32_t WIDTH = 160;
+constexpr uint32_t HEIGHT = 144;
+constexpr int ITERATIONS = 50;
+constexpr uint32_t SHADES[] = {0xFFFFFFFF, 0xFFAAAAAA, 0xFF555555, 0xFF000000};
+constexpr uint32_t FACTORS[] = {4, 8, 12};
+
+const char* filter_name(Upscaler::Filter filter) {
+  switch (filter) {
+    case Upscaler::Filter::Nearest:
+      return "Nearest";
+    case Upscaler::Filter::Smooth:
+      return "Smooth";
+    case Upscaler::Filter::LCD:
+      return "LCD";
+  }
+  return "";
+}
+
+std::vector<uint32_t> make_frame() {
+  std::mt19937 random(1);
+  std::vector<uint32_t> frame(WIDTH * HEIGHT);
+  for (uint32_t tile_y = 0; tile_y < HEIGHT; tile_y += 8) {
+    for (uint32_t tile_x = 0; tile_x < WIDTH; tile_x += 8) {
+      const uint32_t back = SHADES[random() % 4];
+      const uint32_t front = SHADES[random() % 4];
+      const bool rising = random() % 2;
+      for (uint32_t y = 0; y < 8; y++) {
+        for (uint32_t x = 0; x < 8; x++) {
+          frame[(tile_y + y) * WIDTH + tile_x + x] = (rising ? x + y < 8 : x < y) ? front : back;
+        }
+      }
+    }
+  }
+  return frame;
+}
+
+bool nearest_matches(const std::vector<uint32_t>& frame, const std::vector<uint32_t>& out, uint32_t factor) {
+  for (uint32_t y = 0; y < HEIGHT * factor; y++) {
+    for (uint32_t x = 0; x < WIDTH * factor; x++) {
+      if (out[y * WIDTH * factor + x] != frame[(y / factor) * WIDTH + x / factor]) {
+        return false;
+      }
+    }
+  }
+  return true;
+}
+
+// Scales the frame ITERATIONS times and reports the fastest and the median frame
+std::vector<uint32_t> report(Upscaler& upscaler, const std::vector<uint32_t>& frame, uint32_t factor,
+                             Upscaler::Filter filter) {
+  std::vector<uint32_t> out(WIDTH * factor * HEIGHT * factor);
+  const size_t out_pitch = WIDTH * factor * sizeof(uint32_t);
+  std::vector<double> samples;
+  for (int i = 0; i < ITERATIONS; i++) {
+    auto start = steady_clock::now();
+    upscaler.scale(frame.data(), WIDTH * sizeof(uint32_t), WIDTH, HEIGHT, out.data(), out_pitch, factor, filter);
+    samples.push_back(duration<double, std::micro>(steady_clock::now() - start).count());
+  }
+  std::sort(samples.begin(), samples.end());
+  std::cout << filter_name(filter) << " " << factor << "x, " << upscaler.threads() << " thread(s): min "
+            << samples.front() << "us, median " << samples[samples.size() / 2] << "us" << std::endl;
+  return out;
+}
+}  // namespace
+
+int main() {
+  const std::vector<uint32_t> frame = make_frame();
+  Upscaler single(1);
+  // The default, or enough threads to check the bands meet up even on a single core
+  Upscaler pooled(std::thread::hardware_concurrency() > 1 ? 0 : 4);
+  for (uint32_t factor : FACTORS) {
+    for (uint32_t i = 0; i < Upscaler::FILTER_COUNT; i++) {
+      const Upscaler::Filter filter = static_cast<Upscaler::Filter>(i);
+      const std::vector<uint32_t> expected = report(single, frame, factor, filter);
+      if (report(pooled, frame, factor, filter) != expected) {
+        std::cerr << filter_name(filter) << " " << factor << "x differs between threads" << std::endl;
+        return 1;
+      }
+      if (filter == Upscaler::Filter::Nearest && !nearest_matches(frame, expected, factor)) {
+        std::cerr << "Nearest " << factor << "x doesn't match the frame" << std::endl;
+        return 1;
+      }
+    }
+  }
+  return 0;
+}
@@ -0,0 +1,72 @@
+#include "boot_state_cache.h"
+#include <cstdio>
+#include <filesystem>
+#include <fstream>
+#include <iostream>
+#include "memory_controller.h"
+#include "rom_loader.h"
+
+// ===== Boot State Key Constants =====
+namespace {
+constexpr uint64_t FNV_OFFSET_BASIS = 0xCBF29CE484222325ull;  // 64-bit FNV-1a
+constexpr uint64_t FNV_PRIME = 0x100000001B3ull;
+
+uint64_t fnv1a(uint64_t hash, const unsigned char* data, size_t size) {
+  for (size_t i = 0; i < size; i++) {
+    hash = (hash ^ data[i]) * FNV_PRIME;
+  }
+  return hash;
+}
+}  // namespace
+
+BootStateCache::BootStateCache(std::string directory) : directory_(std::move(directory)) {}
+
+uint64_t BootStateCache::key(const ROMLoader& loader) {
+  uint64_t hash = fnv1a(FNV_OFFSET_BASIS, loader.boot_rom_data(), MemoryControllerConstants::BOOT_ROM_SIZE);
+  return fnv1a(hash, reinterpret_cast<const unsigned char*>(loader.header()), sizeof(ROMHeader));
+}
+
+std::string BootStateCache::path_for(uint64_t key) const {
+  char name[32];
+  snprintf(name, sizeof(name), "%016llx.boot", static_cast<unsigned long long>(key));
+  return (std::filesystem::path(directory_) / name).string();
+}
+
+const std::vector<uint8_t>* BootStateCache::find(uint64_t key) {
+  if (auto it = entries_.find(key); it != entries_.end()) {
+    return &it->second;
+  }
+
+  std::ifstream file(path_for(key), std::ios::binary | std::ios::ate);
+  if (!file.is_open()) {
+    return nullptr;
+  }
+  std::vector<uint8_t> state(static_cast<size_t>(file.tellg()));
+  file.seekg(0);
+  if (!file.read(reinterpret_cast<char*>(state.data()), state.size())) {
+    return nullptr;
+  }
+  return &(entries_[key] = std::move(state));
+}
+
+void BootStateCache::store(uint64_t key, std::vector<uint8_t> state) {
+  const std::string path = path_for(key);
+  std::error_code error;
+  std::filesystem::create_directories(directory_, error);
+
+  std::ofstream file(path, std::ios::binary);
+  file.write(reinterpret_cast<const char*>(state.data()), state.size());
+  if (error || !file.good()) {
+    std::cerr << "BootStateCache: Failed to write " << path << std::endl;
+  } else {
+    std::cout << "BootStateCache: Saved boot state to " << path << std::endl;
+  }
+
+  entries_[key] = std::move(state);
+}
+
+void BootStateCache::erase(uint64_t key) {
+  entries_.erase(key);
+  std::error_code error;
+  std::filesystem::remove(path_for(key), error);
+}
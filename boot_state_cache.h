@@ -0,0 +1,31 @@
+#pragma once
+
+#include <cstdint>
+#include <string>
+#include <unordered_map>
+#include <vector>
+
+class ROMLoader;
+
+// Machine state captured the moment the boot ROM unmaps itself, so later boots of the same cartridge can skip
+// the boot animation. Entries are sectioned save state files, kept in memory and mirrored to one file per key
+// in a cache directory. Disk errors only cost the cache entry; they are logged and otherwise ignored.
+class BootStateCache {
+public:
+  explicit BootStateCache(std::string directory);
+
+  // Identifies one boot: the boot ROM and the cartridge header it reads (logo, title and checksums)
+  static uint64_t key(const ROMLoader& loader);
+
+  // Returns nullptr on a miss. Entries found on disk are kept in memory from then on.
+  const std::vector<uint8_t>* find(uint64_t key);
+  void store(uint64_t key, std::vector<uint8_t> state);
+  // Drops an entry that turned out to be unusable, e.g. written by an older version
+  void erase(uint64_t key);
+
+private:
+  std::string path_for(uint64_t key) const;
+
+  std::string directory_;
+  std::unordered_map<uint64_t, std::vector<uint8_t>> entries_;
+};
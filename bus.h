@@ -1,6 +1,7 @@
 #pragma once
 
-class PPU;
+#include "ppu_policy.h"
+
 class APU;
 class Timer;
 class HardwareRegisters;
@@ -30,6 +30,7 @@ public:
 
   void set_apu_callback(const std::function<void()>& callback);
 
+  static constexpr uint32_t SAVE_STATE_VERSION = 1;
   void serialize(SaveStateSerializer& serializer) const;
   void deserialize(SaveStateSerializer& serializer);
 
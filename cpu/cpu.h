@@ -7,11 +7,11 @@
 #include "joypad.h"
 #include "memory_bridge.h"
 #include "memory_controller.h"
+#include "ppu_policy.h"
 #include "program_counter.h"
 #include "stack.h"
 
 class ROMLoader;
-class PPU;
 class APU;
 class SaveStateSerializer;
 
@@ -35,11 +35,16 @@ public:
   // Accessors
   CPURegisters& registers() { return registers_; }
   MemoryController& mc() { return mc_; }
+  const MemoryController& mc() const { return mc_; }
+  Timer& timer() { return timer_; }
+  const Timer& timer() const { return timer_; }
   HardwareRegisters& hardware_registers() { return hw_registers_; }
   ProgramCounter<Bus>& pc() { return pc_; }
   FirstLevelMemoryBridge<Bus>& memory_bridge() { return memory_bridge_; }
   Stack<Bus>& stack() { return stack_; }
 
+  // Registers, interrupt and joypad state only; the memory controller and timer have their own save state sections
+  static constexpr uint32_t SAVE_STATE_VERSION = 2;
   void serialize(SaveStateSerializer& serializer) const;
   void deserialize(SaveStateSerializer& serializer);
 
@@ -1,7 +1,10 @@
 #pragma once
 
+#include <algorithm>
 #include <cstdint>
-#include <fstream>
+#include <cstring>
+#include <iostream>
+#include <span>
 #include <stdexcept>
 #include <string>
 #include <type_traits>
@@ -11,7 +14,7 @@
 class SaveStateSerializer;
 
 namespace {
-constexpr uint32_t SERIALIZER_VERSION = 1;
+constexpr uint32_t SERIALIZER_VERSION = 2;
 
 template <typename T>
 concept IsNotPointer = !std::is_pointer_v<T>;
@@ -51,52 +54,59 @@ struct is_vector_like<StackVector<U, N>> : std::true_type {};
 template <typename T>
 concept IsVectorType = is_vector_like<T>::value && HasPushBack<T>;
 
+// Elements that are serialized as raw bytes anyway, so a whole vector of them can be copied in one go
+template <typename T>
+concept BulkCopyable = IsNotPointer<T> && std::is_standard_layout_v<T> && std::is_trivially_copyable_v<T>;
+
 }  // namespace
 
 class SaveStateSerializer {
 public:
-  SaveStateSerializer(const std::string& filepath, bool for_reading) : for_reading_(for_reading) {
-    std::ios::openmode mode = std::ios::binary;
+  // Serialize to / from a memory buffer. Files are read and written whole by SaveStateReader and SaveStateWriter,
+  // a section at a time through these. When writing, the buffer is cleared but keeps its capacity, so a reused
+  // buffer doesn't allocate. Snapshots are only ever restored into the MainLoop that produced them, so immutable
+  // data (ROM banks) is left out of them.
+  SaveStateSerializer(std::vector<uint8_t>& buffer, bool for_reading, bool snapshot)
+      : for_reading_(for_reading), snapshot_(snapshot) {
     if (for_reading_) {
-      mode |= std::ios::in;
+      read_data_ = buffer;
     } else {
-      mode |= std::ios::out;
-    }
-
-    stream_.open(filepath, mode);
-    if (!stream_.is_open()) {
-      throw std::runtime_error("Failed to open save state file: " + filepath);
+      write_buffer_ = &buffer;
+      write_buffer_->clear();
     }
   }
 
-  ~SaveStateSerializer() {
-    if (stream_.is_open()) {
-      stream_.close();
-    }
-  }
+  // Deserialize from a read-only view, such as one section of a loaded or memory-mapped save state file
+  SaveStateSerializer(std::span<const uint8_t> data, bool snapshot)
+      : for_reading_(true), read_data_(data), snapshot_(snapshot) {}
+
+  bool is_snapshot() const { return snapshot_; }
 
-  // Check if the serializer is in a valid state
-  bool is_valid() const { return stream_.is_open() && stream_.good(); }
+  // Whether the data is a save state section written before the given version of its layout, so components
+  // can migrate older layouts. Snapshots are always in the current layout.
+  bool section_older_than(uint32_t version) const { return section_version_ != 0 && section_version_ < version; }
+  void set_section_version(uint32_t version) { section_version_ = version; }
 
   template <typename T>
   void print_index() {
     if (false)
-      std::cout << "Index: " << stream_.tellp() << " for type: " << typeid(T).name() << std::endl;
+      std::cout << "Index: " << (for_reading_ ? read_position_ : write_buffer_->size())
+                << " for type: " << typeid(T).name() << std::endl;
   }
 
   template <typename T>
     requires IsNotPointer<T> && (Integral<T> || std::is_floating_point_v<T>)
   SaveStateSerializer& operator<<(const T& value) {
     print_index<T>();
-    stream_.write(reinterpret_cast<const char*>(&value), sizeof(T));
+    write_bytes(&value, sizeof(T));
     return *this;
   }
 
   SaveStateSerializer& operator<<(const std::string& value) {
     print_index<std::string>();
     uint32_t length = static_cast<uint32_t>(value.length());
-    stream_.write(reinterpret_cast<const char*>(&length), sizeof(length));
-    stream_.write(value.data(), length);
+    write_bytes(&length, sizeof(length));
+    write_bytes(value.data(), length);
     return *this;
   }
 
@@ -112,8 +122,10 @@ public:
     requires IsNotPointer<T> && std::is_standard_layout_v<T> && (!IsVectorType<T>) && (!Integral<T>) &&
              (!std::is_floating_point_v<T>)
   SaveStateSerializer& operator<<(const T& value) {
+    static_assert(std::has_unique_object_representations_v<T>,
+                  "Padding bytes are indeterminate; serialize the fields of this type one by one");
     print_index<T>();
-    stream_.write(reinterpret_cast<const char*>(&value), sizeof(T));
+    write_bytes(&value, sizeof(T));
     return *this;
   }
 
@@ -122,9 +134,15 @@ public:
   SaveStateSerializer& operator<<(const T& value) {
     uint32_t size = static_cast<uint32_t>(value.size());
     print_index<T>();
-    stream_.write(reinterpret_cast<const char*>(&size), sizeof(size));
-    for (const auto& item : value) {
-      *this << item;
+    write_bytes(&size, sizeof(size));
+    if constexpr (BulkCopyable<typename T::value_type>) {
+      static_assert(std::has_unique_object_representations_v<typename T::value_type>,
+                    "Padding bytes are indeterminate; serialize the fields of this type one by one");
+      write_bytes(value.data(), size * sizeof(typename T::value_type));
+    } else {
+      for (const auto& item : value) {
+        *this << item;
+      }
     }
     return *this;
   }
@@ -133,16 +151,17 @@ public:
     requires IsNotPointer<T> && (Integral<T> || std::is_floating_point_v<T>)
   SaveStateSerializer& operator>>(T& value) {
     print_index<T>();
-    stream_.read(reinterpret_cast<char*>(&value), sizeof(T));
+    read_bytes(&value, sizeof(T));
     return *this;
   }
 
   SaveStateSerializer& operator>>(std::string& value) {
     print_index<std::string>();
     uint32_t length;
-    stream_.read(reinterpret_cast<char*>(&length), sizeof(length));
+    read_bytes(&length, sizeof(length));
+    require_remaining(length, 1);
     value.resize(length);
-    stream_.read(value.data(), length);
+    read_bytes(value.data(), length);
     return *this;
   }
 
@@ -159,21 +178,28 @@ public:
              (!std::is_floating_point_v<T>)
   SaveStateSerializer& operator>>(T& value) {
     print_index<T>();
-    stream_.read(reinterpret_cast<char*>(&value), sizeof(T));
+    read_bytes(&value, sizeof(T));
     return *this;
   }
 
   template <typename T>
   SaveStateSerializer& operator>>(std::vector<T>& value) {
     print_index<std::vector<T>>();
-    value.clear();
     uint32_t size;
-    stream_.read(reinterpret_cast<char*>(&size), sizeof(size));
-    value.reserve(size);
-    for (uint32_t i = 0; i < size; i++) {
-      T item;
-      *this >> item;
-      value.push_back(item);
+    read_bytes(&size, sizeof(size));
+    // Every element takes at least a byte, so a count the data can't hold is caught before anything is sized for it
+    require_remaining(size, BulkCopyable<T> ? sizeof(T) : 1);
+    if constexpr (BulkCopyable<T>) {
+      value.resize(size);
+      read_bytes(value.data(), size * sizeof(T));
+    } else {
+      value.clear();
+      value.reserve(size);
+      for (uint32_t i = 0; i < size; i++) {
+        T item;
+        *this >> item;
+        value.push_back(item);
+      }
     }
     return *this;
   }
@@ -181,18 +207,47 @@ public:
   template <typename T, size_t N>
   SaveStateSerializer& operator>>(StackVector<T, N>& value) {
     print_index<StackVector<T, N>>();
-    value.clear();
     uint32_t size;
-    stream_.read(reinterpret_cast<char*>(&size), sizeof(size));
-    for (uint32_t i = 0; i < size; i++) {
-      T item;
-      *this >> item;
-      value.push_back(item);
+    read_bytes(&size, sizeof(size));
+    if (size > N) {
+      throw std::runtime_error("Save state holds more elements than fit in a StackVector");
+    }
+    if constexpr (BulkCopyable<T>) {
+      value.resize(size);
+      read_bytes(value.data(), size * sizeof(T));
+    } else {
+      value.clear();
+      for (uint32_t i = 0; i < size; i++) {
+        T item;
+        *this >> item;
+        value.push_back(item);
+      }
     }
     return *this;
   }
 
 private:
-  std::fstream stream_;
+  void write_bytes(const void* data, size_t size) {
+    const auto* bytes = static_cast<const uint8_t*>(data);
+    write_buffer_->insert(write_buffer_->end(), bytes, bytes + size);
+  }
+
+  void require_remaining(uint64_t count, size_t element_size) const {
+    if (count * element_size > read_data_.size() - read_position_) {
+      throw std::runtime_error("Save state buffer underrun");
+    }
+  }
+
+  void read_bytes(void* data, size_t size) {
+    require_remaining(size, 1);
+    memcpy(data, read_data_.data() + read_position_, size);
+    read_position_ += size;
+  }
+
   bool for_reading_;
+  std::vector<uint8_t>* write_buffer_ = nullptr;
+  std::span<const uint8_t> read_data_;
+  size_t read_position_ = 0;
+  bool snapshot_ = false;
+  uint32_t section_version_ = 0;
 };
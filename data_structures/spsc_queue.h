@@ -0,0 +1,73 @@
+#pragma once
+
+#include <algorithm>
+#include <array>
+#include <atomic>
+#include <cstddef>
+
+// A fixed size ring buffer for exactly one producer thread and one consumer thread, without locks. The consumer
+// can sleep until something is pushed; pushes only wake it when the producer asks, so a run of pushes that need
+// no immediate attention costs no system calls.
+template <typename T, size_t N>
+class SPSCQueue {
+  static_assert((N & (N - 1)) == 0, "SPSCQueue capacity must be a power of two");
+
+public:
+  // Producer side. Returns false if the queue is full.
+  bool try_push(const T& value) {
+    const size_t tail = tail_.load(std::memory_order_relaxed);
+    if (tail - head_.load(std::memory_order_acquire) == N) {
+      return false;
+    }
+    items_[tail % N] = value;
+    tail_.store(tail + 1, std::memory_order_release);
+    return true;
+  }
+
+  // Producer side. Pushes all count values, or returns false and pushes none if they don't all fit.
+  bool try_push(const T* values, size_t count) {
+    const size_t tail = tail_.load(std::memory_order_relaxed);
+    if (N - (tail - head_.load(std::memory_order_acquire)) < count) {
+      return false;
+    }
+    for (size_t i = 0; i < count; i++) {
+      items_[(tail + i) % N] = values[i];
+    }
+    tail_.store(tail + count, std::memory_order_release);
+    return true;
+  }
+
+  // Producer side. Wakes the consumer if it is sleeping in wait_for_item.
+  void wake_consumer() { tail_.notify_one(); }
+
+  // Consumer side. The oldest item, or nullptr if the queue is empty. It stays in the queue until pop.
+  const T* front() const {
+    const size_t head = head_.load(std::memory_order_relaxed);
+    if (head == tail_.load(std::memory_order_acquire)) {
+      return nullptr;
+    }
+    return &items_[head % N];
+  }
+
+  // Consumer side
+  void pop() { head_.store(head_.load(std::memory_order_relaxed) + 1, std::memory_order_release); }
+
+  // Consumer side. Moves up to count of the oldest items into values, returning how many there were.
+  size_t pop(T* values, size_t count) {
+    const size_t head = head_.load(std::memory_order_relaxed);
+    count = std::min(count, tail_.load(std::memory_order_acquire) - head);
+    for (size_t i = 0; i < count; i++) {
+      values[i] = items_[(head + i) % N];
+    }
+    head_.store(head + count, std::memory_order_release);
+    return count;
+  }
+
+  // Consumer side. Sleeps while the queue is empty, until the producer calls wake_consumer after a push.
+  void wait_for_item() const { tail_.wait(head_.load(std::memory_order_relaxed), std::memory_order_acquire); }
+
+private:
+  std::array<T, N> items_;
+  alignas(64) std::atomic<size_t> head_ = 0;  // Next item to pop, only written by the consumer
+  alignas(64) std::atomic<size_t> tail_ = 0;  // Next slot to push into, only written by the producer
+};
@@ -0,0 +1,107 @@
+#pragma once
+
+#include <algorithm>
+#include <array>
+#include <bit>
+#include <cstddef>
+#include <cstdint>
+#include <cstring>
+#include <span>
+#include <type_traits>
+
+// ===== State Hash Constants =====
+namespace StateHashConstants {
+constexpr uint64_t PRIME_1 = 0x9E3779B185EBCA87ull;  // xxHash64 primes
+constexpr uint64_t PRIME_2 = 0xC2B2AE3D27D4EB4Full;
+constexpr uint64_t PRIME_3 = 0x165667B19E3779F9ull;
+constexpr size_t LANES = 4;                           // Independent accumulators, 32 bytes per step
+constexpr size_t HASH_PAGE_SIZE = 256;                // Granularity of dirty tracking for large memories
+}  // namespace StateHashConstants
+
+// A fast non-cryptographic 64-bit hash in the style of xxHash64. Four independent lanes keep the multipliers
+// busy and let the compiler vectorise the main loop; it runs at memory speed on a few KB of state.
+inline uint64_t hash_bytes(const uint8_t* data, size_t size, uint64_t seed = 0) {
+  using namespace StateHashConstants;
+  auto load = [](const uint8_t* p) {
+    uint64_t value;
+    memcpy(&value, p, sizeof(value));
+    return value;
+  };
+  auto round = [](uint64_t lane, uint64_t input) { return std::rotl(lane + input * PRIME_2, 31) * PRIME_1; };
+
+  std::array<uint64_t, LANES> lanes = {seed + PRIME_1 + PRIME_2, seed + PRIME_2, seed, seed - PRIME_1};
+  size_t i = 0;
+  for (; i + LANES * sizeof(uint64_t) <= size; i += LANES * sizeof(uint64_t)) {
+    for (size_t lane = 0; lane < LANES; lane++) {
+      lanes[lane] = round(lanes[lane], load(data + i + lane * sizeof(uint64_t)));
+    }
+  }
+
+  uint64_t hash =
+      std::rotl(lanes[0], 1) + std::rotl(lanes[1], 7) + std::rotl(lanes[2], 12) + std::rotl(lanes[3], 18);
+  hash += size;
+  for (; i + sizeof(uint64_t) <= size; i += sizeof(uint64_t)) {
+    hash = std::rotl(hash ^ round(0, load(data + i)), 27) * PRIME_1 + PRIME_3;
+  }
+  for (; i < size; i++) {
+    hash = std::rotl(hash ^ (data[i] * PRIME_3), 11) * PRIME_1;
+  }
+
+  hash ^= hash >> 33;
+  hash *= PRIME_2;
+  hash ^= hash >> 29;
+  hash *= PRIME_3;
+  hash ^= hash >> 32;
+  return hash;
+}
+
+inline uint64_t hash_bytes(std::span<const uint8_t> data, uint64_t seed = 0) {
+  return hash_bytes(data.data(), data.size(), seed);
+}
+
+// Only for types without padding, whose bytes are indeterminate and would make equal states hash differently
+template <typename T>
+  requires std::is_trivially_copyable_v<T> && std::has_unique_object_representations_v<T>
+uint64_t hash_object(const T& value, uint64_t seed) {
+  return hash_bytes(reinterpret_cast<const uint8_t*>(&value), sizeof(T), seed);
+}
+
+// Hash of a large block of memory that only rehashes the pages written since the last call. The owner calls
+// mark() on every write and mark_all() whenever the memory is replaced wholesale (e.g. loading a state).
+template <size_t SIZE>
+class PagedHash {
+public:
+  static constexpr size_t PAGE_COUNT =
+      (SIZE + StateHashConstants::HASH_PAGE_SIZE - 1) / StateHashConstants::HASH_PAGE_SIZE;
+
+  PagedHash() { mark_all(); }
+
+  [[gnu::always_inline]] void mark(size_t offset) {
+    const size_t page = offset / StateHashConstants::HASH_PAGE_SIZE;
+    dirty_[page / 64] |= uint64_t{1} << (page % 64);
+  }
+
+  void mark_all() { dirty_.fill(~uint64_t{0}); }
+
+  // Hash of the first size bytes, for memory that is only partly in use
+  uint64_t hash(const uint8_t* data, size_t size = SIZE) {
+    const size_t page_count = (size + StateHashConstants::HASH_PAGE_SIZE - 1) / StateHashConstants::HASH_PAGE_SIZE;
+    for (size_t word = 0; word < dirty_.size(); word++) {
+      for (uint64_t bits = dirty_[word]; bits; bits &= bits - 1) {
+        const size_t page = word * 64 + std::countr_zero(bits);
+        if (page >= page_count) {
+          break;
+        }
+        const size_t offset = page * StateHashConstants::HASH_PAGE_SIZE;
+        page_hashes_[page] =
+            hash_bytes(data + offset, std::min(StateHashConstants::HASH_PAGE_SIZE, size - offset));
+      }
+      dirty_[word] = 0;
+    }
+    return hash_bytes(reinterpret_cast<const uint8_t*>(page_hashes_.data()), page_count * sizeof(uint64_t));
+  }
+
+private:
+  std::array<uint64_t, (PAGE_COUNT + 63) / 64> dirty_;
+  std::array<uint64_t, PAGE_COUNT> page_hashes_ = {};
+};
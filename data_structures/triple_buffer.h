@@ -0,0 +1,37 @@
+#pragma once
+
+#include <array>
+#include <atomic>
+#include <cstdint>
+
+// Three buffers shared by exactly one producer thread and one consumer thread, without locks. The producer fills
+// one while the consumer reads another, and the third holds the newest finished one between them, so neither side
+// ever waits for the other. Buffers the consumer doesn't take in time are overwritten by newer ones.
+template <typename T>
+class TripleBuffer {
+public:
+  // Producer side. The buffer to fill next, still holding whatever was in it last.
+  T& back() { return buffers_[back_]; }
+
+  // Producer side. Hands the back buffer over as the newest, and takes the one it replaces to fill next.
+  void publish() { back_ = middle_.exchange(back_ | FRESH, std::memory_order_acq_rel) & INDEX_MASK; }
+
+  // Consumer side. The newest buffer if one was published since the last call, or nullptr. It stays untouched by
+  // the producer until the next call.
+  const T* take() {
+    if ((middle_.load(std::memory_order_relaxed) & FRESH) == 0) {
+      return nullptr;
+    }
+    front_ = middle_.exchange(front_, std::memory_order_acq_rel) & INDEX_MASK;
+    return &buffers_[front_];
+  }
+
+private:
+  static constexpr uint8_t INDEX_MASK = 0x03;
+  static constexpr uint8_t FRESH = 0x04;  // Set in middle_ from a publish until the consumer takes it
+
+  std::array<T, 3> buffers_ = {};
+  alignas(64) uint8_t back_ = 0;             // Only touched by the producer
+  alignas(64) std::atomic<uint8_t> middle_ = 1;
+  alignas(64) uint8_t front_ = 2;            // Only touched by the consumer
+};
@@ -0,0 +1,127 @@
+#include "emulation_thread.h"
+#include <chrono>
+#include <cstring>
+
+EmulationThread::EmulationThread(ROMLoader& loader)
+    : frames_(std::make_unique<TripleBuffer<Frame>>()),
+      audio_(std::make_unique<SPSCQueue<int16_t, AUDIO_RING_SIZE>>()),
+      commands_(std::make_unique<SPSCQueue<Command, COMMAND_QUEUE_SIZE>>()),
+      bridge_(get_os_bridge()),
+      loop_(loader, bridge_),
+      jitter_("Emulated frames", JITTER_REPORT_FRAMES) {
+  published_shades_.fill(NO_SHADE);
+}
+
+EmulationThread::~EmulationThread() {
+  if (thread_.joinable()) {
+    push({Command::Type::Stop});
+    thread_.join();
+  }
+}
+
+void EmulationThread::start() {
+  thread_ = std::thread([this]() { run(); });
+}
+
+OSBridge EmulationThread::get_os_bridge() {
+  OSBridge bridge;
+  bridge.on_audio_generated = [this](const int16_t* samples, int num_samples) {
+    // All or nothing, so the stereo pairs stay in step when the presenter falls behind
+    audio_->try_push(samples, static_cast<size_t>(num_samples));
+  };
+  // Shades are a quarter the size of ARGB and nothing else is set, so the loop never converts the frame itself
+  bridge.blit_shades = [this](const uint8_t* shades, size_t pitch) {
+    Frame& frame = frames_->back();
+    auto changed = [&](uint32_t y) {
+      return memcmp(shades + y * pitch, &published_shades_[y * SCREEN_WIDTH], SCREEN_WIDTH) != 0;
+    };
+    frame.changed = {0, SCREEN_HEIGHT};
+    while (!frame.changed.empty() && !changed(frame.changed.first)) {
+      frame.changed.first++;
+    }
+    while (!frame.changed.empty() && !changed(frame.changed.end - 1)) {
+      frame.changed.end--;
+    }
+    // All of it, as the back buffer holds whichever frame was published two before
+    for (uint32_t y = 0; y < SCREEN_HEIGHT; y++) {
+      memcpy(&frame.shades[y * Frame::SHADE_PITCH], shades + y * pitch, SCREEN_WIDTH);
+    }
+    frame_drawn_ = true;
+  };
+  bridge.present_frame = [this]() {
+    // Rewinding past the oldest snapshot presents again without drawing, which leaves the presenter's frame be
+    if (frame_drawn_) {
+      Frame& frame = frames_->back();
+      const uint32_t offset = frame.changed.first * SCREEN_WIDTH;
+      memcpy(&published_shades_[offset], &frame.shades[offset],
+             (frame.changed.end - frame.changed.first) * SCREEN_WIDTH);
+      frame.number = frame_number_;
+      frames_->publish();
+      frame_drawn_ = false;
+    }
+    frame_number_++;
+    jitter_.record(std::chrono::steady_clock::now());
+  };
+  bridge.handle_events = [](JoypadState& joypad_state) { return false; };
+  bridge.audio_buffer_fill = [this]() { return audio_buffer_fill_.load(std::memory_order_relaxed); };
+  return bridge;
+}
+
+void EmulationThread::set_input(const JoypadState& joypad, bool rewind) {
+  if (joypad == sent_joypad_ && rewind == sent_rewind_) {
+    return;
+  }
+  // A full queue means the emulation thread is a frame behind on input already, so try again next time
+  if (commands_->try_push({Command::Type::Input, rewind, joypad})) {
+    sent_joypad_ = joypad;
+    sent_rewind_ = rewind;
+  }
+}
+
+void EmulationThread::set_run_ahead(uint32_t frames) {
+  push({Command::Type::RunAhead, false, {}, frames});
+}
+
+void EmulationThread::set_speed(uint32_t speed) {
+  push({Command::Type::Speed, false, {}, speed});
+}
+
+void EmulationThread::push(const Command& command) {
+  // Only for rare commands: the queue is drained every frame, so this waits a frame at worst
+  while (!commands_->try_push(command)) {
+    std::this_thread::yield();
+  }
+}
+
+bool EmulationThread::take_commands() {
+  for (const Command* command = commands_->front(); command != nullptr; command = commands_->front()) {
+    switch (command->type) {
+      case Command::Type::Input:
+        joypad_ = command->joypad;
+        rewind_ = command->rewind;
+        break;
+      case Command::Type::RunAhead:
+        loop_.set_run_ahead(command->value);
+        break;
+      case Command::Type::Speed:
+        loop_.set_speed(command->value);
+        break;
+      case Command::Type::Stop:
+        commands_->pop();
+        return false;
+    }
+    commands_->pop();
+  }
+  return true;
+}
+
+void EmulationThread::run() {
+  // Input and settings change between frames, as they do on a single thread
+  while (take_commands()) {
+    if (rewind_) {
+      loop_.rewind();
+      continue;
+    }
+    while (!loop_.run(joypad_)) {}
+  }
+}
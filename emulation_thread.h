@@ -0,0 +1,98 @@
+#pragma once
+
+#include <array>
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+#include <memory>
+#include <thread>
+#include "OSBridge.h"
+#include "frame_jitter.h"
+#include "game_screen.h"
+#include "joypad_state.h"
+#include "main_loop.h"
+#include "ppu_constants.h"
+#include "spsc_queue.h"
+#include "triple_buffer.h"
+
+class ROMLoader;
+
+// Runs a MainLoop on a thread of its own, pacing itself, so a slow present or a storm of window events never holds
+// emulation up. Finished frames go to the presenting thread through a triple buffer, as shades for the presenter to
+// convert only the changed lines of, and audio through a ring buffer, and input comes back through a queue; none of
+// them ever block the emulation thread. Apart from loop, only the one presenting thread may call these.
+class EmulationThread {
+public:
+  struct Frame {
+    static constexpr size_t SHADE_PITCH = SCREEN_WIDTH;
+
+    std::array<uint8_t, SCREEN_WIDTH * SCREEN_HEIGHT> shades;  // As OSBridge::blit_shades hands them over
+    GameScreen::LineRange changed;  // Lines that differ from the frame published before, numbered number - 1
+    uint64_t number;  // Of frames presented by the loop, so gaps show the frames the presenter never took
+  };
+
+  explicit EmulationThread(ROMLoader& loader);
+  ~EmulationThread();
+
+  EmulationThread(const EmulationThread&) = delete;
+  EmulationThread& operator=(const EmulationThread&) = delete;
+
+  // For setting the loop up, only until start
+  MainLoop& loop() { return loop_; }
+  void start();
+
+  // Input from the next frame on. Only passed on when it changes, and kept to pass on later if the queue is full.
+  void set_input(const JoypadState& joypad, bool rewind);
+  // Passed on to MainLoop::set_run_ahead and MainLoop::set_speed at the next frame
+  void set_run_ahead(uint32_t frames);
+  void set_speed(uint32_t speed);
+
+  // The newest frame if one was finished since the last call, or nullptr. Left alone until the next call.
+  const Frame* take_frame() { return frames_->take(); }
+  // Moves up to max_samples of the audio produced so far into samples, returning how many. Audio that doesn't fit
+  // the ring buffer while nobody takes it is dropped.
+  size_t take_audio(int16_t* samples, size_t max_samples) { return audio_->pop(samples, max_samples); }
+  // How full the audio device's buffer is, for the loop's audio rate control to read at its next frame
+  void set_audio_buffer_fill(double fill) { audio_buffer_fill_.store(fill, std::memory_order_relaxed); }
+
+private:
+  struct Command {
+    enum class Type : uint8_t { Input, RunAhead, Speed, Stop };
+    Type type;
+    bool rewind;
+    JoypadState joypad;
+    uint32_t value;
+  };
+
+  static constexpr size_t COMMAND_QUEUE_SIZE = 64;
+  static constexpr size_t AUDIO_RING_SIZE = 16384;  // Stereo samples, around 170ms at 48kHz
+  static constexpr uint32_t JITTER_REPORT_FRAMES = 300;
+  static constexpr uint8_t NO_SHADE = 0xFF;  // Differs from every shade, so the first frame is changed throughout
+
+  OSBridge get_os_bridge();
+  void push(const Command& command);
+  void run();
+  bool take_commands();
+
+  std::unique_ptr<TripleBuffer<Frame>> frames_;
+  std::unique_ptr<SPSCQueue<int16_t, AUDIO_RING_SIZE>> audio_;
+  std::unique_ptr<SPSCQueue<Command, COMMAND_QUEUE_SIZE>> commands_;
+  OSBridge bridge_;
+  MainLoop loop_;
+
+  std::atomic<double> audio_buffer_fill_ = 1.0;  // Set by the presenting thread, read by the emulation thread
+
+  // Presenting thread's side
+  JoypadState sent_joypad_;
+  bool sent_rewind_ = false;
+
+  // Emulation thread's side
+  JoypadState joypad_;
+  bool rewind_ = false;
+  bool frame_drawn_ = false;  // Since the last frame was published
+  std::array<uint8_t, SCREEN_WIDTH * SCREEN_HEIGHT> published_shades_;  // Of the last frame published
+  uint64_t frame_number_ = 0;
+  FrameJitter jitter_;
+
+  std::thread thread_;
+};
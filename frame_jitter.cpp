@@ -0,0 +1,34 @@
+#include "frame_jitter.h"
+#include <algorithm>
+#include <cmath>
+#include <iostream>
+
+using namespace std::chrono;
+
+FrameJitter::FrameJitter(std::string name, uint32_t report_frames)
+    : name_(std::move(name)), report_frames_(report_frames) {}
+
+void FrameJitter::record(steady_clock::time_point now) {
+  if (started_) {
+    const double interval_ms = duration<double, std::milli>(now - last_frame_time_).count();
+    shortest_ms_ = intervals_ == 0 ? interval_ms : std::min(shortest_ms_, interval_ms);
+    longest_ms_ = intervals_ == 0 ? interval_ms : std::max(longest_ms_, interval_ms);
+    sum_ms_ += interval_ms;
+    sum_squares_ms_ += interval_ms * interval_ms;
+    if (++intervals_ == report_frames_) {
+      report();
+    }
+  }
+  started_ = true;
+  last_frame_time_ = now;
+}
+
+void FrameJitter::report() {
+  const double mean_ms = sum_ms_ / intervals_;
+  const double deviation_ms = std::sqrt(std::max(sum_squares_ms_ / intervals_ - mean_ms * mean_ms, 0.0));
+  std::cout << name_ << ": " << mean_ms << "ms mean, " << deviation_ms << "ms jitter, " << shortest_ms_ << "ms to "
+            << longest_ms_ << "ms" << std::endl;
+  intervals_ = 0;
+  sum_ms_ = 0;
+  sum_squares_ms_ = 0;
+}
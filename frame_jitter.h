@@ -0,0 +1,28 @@
+#pragma once
+
+#include <chrono>
+#include <cstdint>
+#include <string>
+
+// Measures how evenly frames go by on one thread: every report_frames frames it prints the mean time between them,
+// how far they stray from it (standard deviation) and the shortest and longest gaps.
+class FrameJitter {
+public:
+  FrameJitter(std::string name, uint32_t report_frames);
+
+  // Call once per frame, as it goes out
+  void record(std::chrono::steady_clock::time_point now);
+
+private:
+  void report();
+
+  std::string name_;
+  uint32_t report_frames_;
+  std::chrono::steady_clock::time_point last_frame_time_;
+  bool started_ = false;
+  uint32_t intervals_ = 0;
+  double sum_ms_ = 0;
+  double sum_squares_ms_ = 0;
+  double shortest_ms_ = 0;
+  double longest_ms_ = 0;
+};
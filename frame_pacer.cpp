@@ -0,0 +1,125 @@
+#include "frame_pacer.h"
+#include <time.h>
+#include <algorithm>
+#include <cerrno>
+#include <ctime>
+#include <iostream>
+#include <thread>
+
+using namespace std::chrono;
+
+namespace {
+constexpr nanoseconds MIN_SPIN_MARGIN = microseconds(300);  // Spun before every frame even when sleeps wake on time
+constexpr uint32_t SPIN_MARGIN_DECAY = 64;      // The margin narrows by 1/64th a frame while sleeps wake in time
+constexpr double AUDIO_FILL_SMOOTHING = 0.05;  // Weight of each frame's fill; the buffer jumps a frame at a time
+
+// CPU time used by the calling thread, or the whole process where threads aren't timed separately
+nanoseconds cpu_time() {
+#ifdef CLOCK_THREAD_CPUTIME_ID
+  timespec now;
+  clock_gettime(CLOCK_THREAD_CPUTIME_ID, &now);
+  return seconds(now.tv_sec) + nanoseconds(now.tv_nsec);
+#else
+  return duration_cast<nanoseconds>(duration<double>(static_cast<double>(std::clock()) / CLOCKS_PER_SEC));
+#endif
+}
+}  // namespace
+
+FramePacer::FramePacer(nanoseconds frame_duration)
+    : frame_duration_(frame_duration),
+      adjusted_frame_duration_(frame_duration),
+      spin_margin_(MIN_SPIN_MARGIN),
+      report_cpu_time_(cpu_time()) {}
+
+void FramePacer::wait_for_next_frame() {
+  const auto start = steady_clock::now();
+  const auto due = last_frame_time_ + adjusted_frame_duration_;
+  frames_++;
+  if (start >= due) {
+    late_frames_++;
+    total_error_ += start - due;
+    worst_error_ = std::max<nanoseconds>(worst_error_, start - due);
+    last_frame_time_ = start;
+    return;
+  }
+
+  const auto wake = due - spin_margin_;
+  if (wake > start) {
+    sleep_until(wake);
+    const auto woke = steady_clock::now();
+    // Waking this late would have missed the frame, so leave that much more time to spin from now on
+    const nanoseconds oversleep = woke - wake;
+    if (oversleep >= spin_margin_) {
+      spin_margin_ = std::min<nanoseconds>(oversleep + MIN_SPIN_MARGIN, frame_duration_);
+    } else {
+      spin_margin_ = std::max<nanoseconds>(spin_margin_ - spin_margin_ / SPIN_MARGIN_DECAY, MIN_SPIN_MARGIN);
+    }
+  }
+
+  const auto spin_start = steady_clock::now();
+  auto now = spin_start;
+  while (now < due) {
+    now = steady_clock::now();
+  }
+  spun_ += std::max<nanoseconds>(now - spin_start, nanoseconds(0));
+  waited_ += now - start;
+  total_error_ += now - due;
+  worst_error_ = std::max<nanoseconds>(worst_error_, now - due);
+  last_frame_time_ = due;
+}
+
+void FramePacer::sleep_until(steady_clock::time_point when) {
+#ifdef __linux__
+  // steady_clock is CLOCK_MONOTONIC here, and an absolute deadline survives being interrupted by signals
+  const nanoseconds since_epoch = when.time_since_epoch();
+  const timespec deadline = {static_cast<time_t>(duration_cast<seconds>(since_epoch).count()),
+                             static_cast<long>((since_epoch % seconds(1)).count())};
+  while (clock_nanosleep(CLOCK_MONOTONIC, TIMER_ABSTIME, &deadline, nullptr) == EINTR) {}
+#else
+  std::this_thread::sleep_until(when);
+#endif
+}
+
+void FramePacer::set_audio_fill(double fill) {
+  if (!following_audio_) {
+    following_audio_ = true;
+    audio_fill_ = fill;
+  }
+  audio_fill_ += (fill - audio_fill_) * AUDIO_FILL_SMOOTHING;
+  // Longer frames while the buffer is over its target, so it drains, and shorter ones while it is under
+  const double adjustment = std::clamp((audio_fill_ - 1.0) * MAX_AUDIO_RATE_ADJUSTMENT, -MAX_AUDIO_RATE_ADJUSTMENT,
+                                       MAX_AUDIO_RATE_ADJUSTMENT);
+  adjusted_frame_duration_ = duration_cast<nanoseconds>(frame_duration_ * (1.0 + adjustment));
+}
+
+void FramePacer::clear_audio_fill() {
+  following_audio_ = false;
+  adjusted_frame_duration_ = frame_duration_;
+}
+
+void FramePacer::report() {
+  const auto now = steady_clock::now();
+  const nanoseconds now_cpu_time = cpu_time();
+  if (frames_ > 0) {
+    const double cpu_percent = 100.0 * duration<double>(now_cpu_time - report_cpu_time_).count() /
+                               duration<double>(now - report_time_).count();
+    std::cout << "Pacing: " << duration_cast<microseconds>(total_error_ / frames_).count() << "us mean error, "
+              << duration_cast<microseconds>(worst_error_).count() << "us worst, " << late_frames_ << " of "
+              << frames_ << " frames late, " << duration_cast<microseconds>(spun_ / frames_).count()
+              << "us spun per frame, " << cpu_percent << "% CPU";
+    if (following_audio_) {
+      std::cout << ", audio rate " << static_cast<double>(frame_duration_.count()) / adjusted_frame_duration_.count()
+                << "x";
+    }
+    std::cout << std::endl;
+  }
+
+  frames_ = 0;
+  late_frames_ = 0;
+  total_error_ = nanoseconds(0);
+  worst_error_ = nanoseconds(0);
+  waited_ = nanoseconds(0);
+  spun_ = nanoseconds(0);
+  report_time_ = now;
+  report_cpu_time_ = now_cpu_time;
+}
@@ -0,0 +1,53 @@
+#pragma once
+
+#include <chrono>
+#include <cstdint>
+
+// Holds frames to a steady rate without spinning a core for the whole wait. It sleeps until shortly before each
+// frame is due and spins only the rest of the way, widening that margin whenever the OS wakes it late and slowly
+// narrowing it again. Optionally it follows the audio device instead of the clock alone, nudging the frame rate by
+// up to MAX_AUDIO_RATE_ADJUSTMENT to keep the device's buffer at its target.
+class FramePacer {
+public:
+  static constexpr double MAX_AUDIO_RATE_ADJUSTMENT = 0.005;
+
+  explicit FramePacer(std::chrono::nanoseconds frame_duration);
+
+  // Waits until the next frame is due, a frame after the last one. A frame that is already late is due now, and the
+  // frames after it follow on from it.
+  void wait_for_next_frame();
+  // Starts the schedule again from now, for frames that went out without waiting
+  void restart(std::chrono::steady_clock::time_point now) { last_frame_time_ = now; }
+  std::chrono::steady_clock::time_point last_frame_time() const { return last_frame_time_; }
+
+  // How full the audio device's buffer is, 1 being its target, once a frame to follow it. Stops following it until
+  // called again after clear_audio_fill.
+  void set_audio_fill(double fill);
+  void clear_audio_fill();
+
+  // Time spent waiting since the last report
+  std::chrono::microseconds waited() const { return std::chrono::duration_cast<std::chrono::microseconds>(waited_); }
+  // Prints how far frames went out from when they were due, how the waits were spent, how busy the calling thread
+  // was, and the audio rate adjustment, since the last report
+  void report();
+
+private:
+  void sleep_until(std::chrono::steady_clock::time_point when);
+
+  std::chrono::nanoseconds frame_duration_;
+  std::chrono::nanoseconds adjusted_frame_duration_;  // Following the audio, if it is followed
+  std::chrono::nanoseconds spin_margin_;
+  std::chrono::steady_clock::time_point last_frame_time_ = std::chrono::steady_clock::now();
+  bool following_audio_ = false;
+  double audio_fill_ = 1.0;  // Smoothed over recent frames
+
+  // Since the last report
+  uint32_t frames_ = 0;
+  uint32_t late_frames_ = 0;
+  std::chrono::nanoseconds total_error_{0};
+  std::chrono::nanoseconds worst_error_{0};
+  std::chrono::nanoseconds waited_{0};
+  std::chrono::nanoseconds spun_{0};
+  std::chrono::steady_clock::time_point report_time_ = std::chrono::steady_clock::now();
+  std::chrono::nanoseconds report_cpu_time_;
+};
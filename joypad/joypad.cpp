@@ -1,6 +1,7 @@
 #include "joypad.h"
 #include <cstdint>
 #include "hardware_registers.h"
+#include "save_state.h"
 
 namespace {
 constexpr uint8_t SSBA_MASK = 0x20;
@@ -89,3 +90,13 @@ void Joypad::joypad_write() {
     hw_registers_.trigger_joypad_interrupt();
   }
 }
+
+void Joypad::serialize(SaveStateSerializer& serializer) const {
+  serializer << joypad_state_;
+  serializer << joypad_interrupts_;
+}
+
+void Joypad::deserialize(SaveStateSerializer& serializer) {
+  serializer >> joypad_state_;
+  serializer >> joypad_interrupts_;
+}
@@ -4,6 +4,7 @@
 #include "joypad_state.h"
 
 class HardwareRegisters;
+class SaveStateSerializer;
 
 class Joypad {
 public:
@@ -11,6 +12,10 @@ public:
   void update_state(JoypadState& joypad_state);
   void joypad_write();
 
+  // Held buttons and pending press edges, so restored snapshots see the same edges as the original run
+  void serialize(SaveStateSerializer& serializer) const;
+  void deserialize(SaveStateSerializer& serializer);
+
 private:
   void handle_button(bool pressed, uint8_t bit);
 
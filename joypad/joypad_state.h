@@ -9,4 +9,6 @@ struct JoypadState {
   bool left_pressed = false;
   bool up_pressed = false;
   bool down_pressed = false;
+
+  bool operator==(const JoypadState&) const = default;
 };
\ No newline at end of file
@@ -0,0 +1,117 @@
+#include <algorithm>
+#include <array>
+#include <chrono>
+#include <iostream>
+#include <optional>
+#include <thread>
+#include <vector>
+#include "SDLWindow.h"
+#include "emulation_thread.h"
+#include "frame_jitter.h"
+#include "game_screen.h"
+#include "joypad_state.h"
+#include "main_loop.h"
+#include "rom_loader.h"
+
+// The SDL frontend for Linux. This thread only handles window events, shows frames and queues audio, while the
+// emulation runs and paces itself on an EmulationThread, so neither can hold the other up.
+
+using namespace std::chrono;
+
+namespace {
+constexpr size_t REWIND_MEMORY_BUDGET_BYTES = 32 * 1024 * 1024;  // Memory kept for rewind history
+constexpr uint32_t REWIND_FRAMES_PER_SNAPSHOT = 1;               // Record every frame for smooth rewind
+constexpr uint32_t MAX_RUN_AHEAD_FRAMES = 4;                      // Games rarely lag more than this
+constexpr std::array<uint32_t, 5> TURBO_SPEEDS = {1, 2, 4, 8, MainLoop::UNCAPPED_SPEED};  // F9 steps through these
+constexpr uint32_t JITTER_REPORT_FRAMES = 300;
+constexpr milliseconds FRAME_POLL_INTERVAL(1);  // How long to sleep when no new frame is ready
+constexpr size_t AUDIO_CHUNK_SAMPLES = 8192;    // Most audio taken at once, an even number to keep stereo pairs
+}  // namespace
+
+// Usage: GBEmu <rom> [boot rom]
+int main(int argc, char** argv) {
+  if (argc < 2) {
+    std::cerr << "Usage: GBEmu <rom> [boot rom]" << std::endl;
+    return -1;
+  }
+
+  std::optional<ROMLoader> loader;
+  if (argc > 2) {
+    loader.emplace(argv[1], argv[2]);
+  } else {
+    loader.emplace(argv[1]);
+  }
+  if (!loader->load()) {
+    std::cerr << "Failed to load ROM: " << loader->get_load_error() << std::endl;
+    return -1;
+  }
+  loader->header()->pretty_print();
+  loader->check_compatibility();
+
+  SDLWindow window("GBEmu", SCREEN_WIDTH, SCREEN_HEIGHT);
+  window.clear();
+
+  EmulationThread emulation(*loader);
+  emulation.loop().enable_rewind(REWIND_MEMORY_BUDGET_BYTES, REWIND_FRAMES_PER_SNAPSHOT);
+  // Drawing on a third thread only pays off with a core to spare besides this one and the emulation's
+  emulation.loop().set_render_thread(std::thread::hardware_concurrency() > 2);
+  emulation.loop().set_audio_rate_control(true);
+
+  uint32_t run_ahead_frames = 0;
+  uint32_t speed = 1;
+  bool exit_requested = false;
+  window.set_on_run_ahead_change([&](int delta) {
+    run_ahead_frames = static_cast<uint32_t>(
+        std::clamp<int>(static_cast<int>(run_ahead_frames) + delta, 0, MAX_RUN_AHEAD_FRAMES));
+    std::cout << "Run-ahead: " << run_ahead_frames << " frames" << std::endl;
+    emulation.set_run_ahead(run_ahead_frames);
+  });
+  window.set_on_turbo_cycle([&]() {
+    auto current = std::find(TURBO_SPEEDS.begin(), TURBO_SPEEDS.end(), speed);
+    const bool wrap = current == TURBO_SPEEDS.end() || current + 1 == TURBO_SPEEDS.end();
+    speed = wrap ? TURBO_SPEEDS[0] : *(current + 1);
+    if (speed == MainLoop::UNCAPPED_SPEED) {
+      std::cout << "Speed: uncapped" << std::endl;
+    } else {
+      std::cout << "Speed: " << speed << "x" << std::endl;
+    }
+    emulation.set_speed(speed);
+  });
+  window.set_on_exit([&]() { exit_requested = true; });
+
+  emulation.start();
+
+  FrameJitter jitter("Presented frames", JITTER_REPORT_FRAMES);
+  std::vector<int16_t> audio(AUDIO_CHUNK_SAMPLES);
+  std::optional<uint64_t> shown_number;  // Of the frame last drawn into the window
+  JoypadState joypad_state;
+  while (!window.handleEvents(joypad_state) && !exit_requested) {
+    emulation.set_input(joypad_state, window.rewind_held());
+
+    const EmulationThread::Frame* frame = emulation.take_frame();
+    if (frame == nullptr) {
+      std::this_thread::sleep_for(FRAME_POLL_INTERVAL);
+      continue;
+    }
+    for (size_t taken = emulation.take_audio(audio.data(), audio.size()); taken > 0;
+         taken = emulation.take_audio(audio.data(), audio.size())) {
+      window.queue_audio(audio.data(), static_cast<int>(taken));
+    }
+    emulation.set_audio_buffer_fill(window.audio_buffer_fill());
+    // A frame's changed lines are only against the one published before it, so after a gap all of them are redrawn
+    GameScreen::LineRange lines = frame->changed;
+    if (!shown_number || frame->number != *shown_number + 1) {
+      lines = {0, SCREEN_HEIGHT};
+    }
+    shown_number = frame->number;
+    if (!lines.empty()) {
+      size_t pitch = 0;
+      uint32_t* pixels = window.lock_screen(lines.first, lines.end, pitch);
+      GameScreen::convert_lines(frame->shades.data(), EmulationThread::Frame::SHADE_PITCH, lines, pixels, pitch);
+    }
+    window.unlock_screen();
+    window.present();
+    jitter.record(steady_clock::now());
+  }
+  return 0;
+}
@@ -1,17 +1,35 @@
-
+#include <cstdlib>
+#include <cstring>
+#include <vector>
 #include "GBEmulator.h"
 #include "MacUI.h"
 
+// Usage: GBEmu [rom] [boot rom] [--netplay <local port> <peer host> <peer port>]
 int main(int argc, char** argv) {
-  const char* filename = argc > 1 ? argv[1] : nullptr;
+  std::vector<const char*> arguments;
+  const char* const* netplay = nullptr;
+  for (int i = 1; i < argc; i++) {
+    if (strcmp(argv[i], "--netplay") == 0 && i + 3 < argc) {
+      netplay = &argv[i + 1];
+      i += 3;
+    } else {
+      arguments.push_back(argv[i]);
+    }
+  }
+
+  const char* filename = arguments.size() > 0 ? arguments[0] : nullptr;
   GBEmulator<MacUI> emu(filename);
 
-  const char* boot_rom_filename = argc > 2 ? argv[2] : nullptr;
+  const char* boot_rom_filename = arguments.size() > 1 ? arguments[1] : nullptr;
   if (boot_rom_filename) {
     emu.set_boot_rom(boot_rom_filename);
   }
 
+  if (netplay) {
+    emu.start_netplay(static_cast<uint16_t>(std::atoi(netplay[0])), netplay[1],
+                      static_cast<uint16_t>(std::atoi(netplay[2])));
+  }
+
   emu.run();
   return 0;
 }
-
@@ -1,10 +1,15 @@
 #include "main_loop.h"
+#include <algorithm>
 #include <chrono>
 #include <iostream>
 #include "OSBridge.h"
+#include "boot_state_cache.h"
+#include "game_screen.h"
 #include "joypad_state.h"
 #include "ppu_bridge.h"
 #include "rom_loader.h"
+#include "save_state.h"
+#include "save_state_file.h"
 
 using namespace std::chrono;
 
@@ -13,33 +18,95 @@ namespace {
 constexpr std::chrono::microseconds TARGET_FRAME_DURATION_MICROSECONDS(
     16740);                                         // Game Boy runs at 59.73 Hz (16.74ms)
 constexpr uint32_t FPS_MEASUREMENT_INTERVAL = 300;  // Measure FPS every 300 frames
+constexpr uint32_t M_CYCLES_PER_FRAME = 17556;      // Upper bound on instructions needed to finish a frame
+constexpr double FRAMES_PER_SECOND = 59.73;
+constexpr uint32_t REWIND_KEYFRAME_INTERVAL_FRAMES = 60;  // A full rewind snapshot roughly once a second
+
+// The two PPU builds save different state, so each gets a section of its own and a state from the other build
+// fails to load instead of being misread
+#ifdef GBEMU_FIFO_PPU
+constexpr SaveStateSection PPU_SECTION = SaveStateSection::PPUFifo;
+#else
+constexpr SaveStateSection PPU_SECTION = SaveStateSection::PPU;
+#endif
 }  // namespace
 
 MainLoop::MainLoop(ROMLoader& loader, OSBridge& os_bridge)
     : cpu_(loader, ppu_, apu_, bus_),
       ppu_bridge_({[&]() { cpu_.hardware_registers().trigger_vblank_interrupt(); },
-                   [&]() { cpu_.hardware_registers().trigger_lcd_stat_interrupt(); }, os_bridge.blit_screen,
+                   [&]() { cpu_.hardware_registers().trigger_lcd_stat_interrupt(); },
+                   [this](GameScreen& screen) { blit_frame(screen); },
                    [&]() { return cpu_.is_halted(); },
                    [&](uint16_t address) -> const uint8_t* { return cpu_.memory_bridge().read(address); }}),
       ppu_(ppu_bridge_, loader.has_boot_rom()),
-      apu_(os_bridge.on_audio_generated),
+      apu_([this](const int16_t* samples, int num_samples) {
+        if (mute_audio_) {
+          return;
+        }
+        if (speed_ != 1) {
+          auto decimated = audio_decimator_.process(samples, num_samples);
+          os_bridge_.on_audio_generated(decimated.data(), static_cast<int>(decimated.size()));
+        } else {
+          os_bridge_.on_audio_generated(samples, num_samples);
+        }
+      }),
+      pacer_(TARGET_FRAME_DURATION_MICROSECONDS),
       os_bridge_(os_bridge) {}
 
+void MainLoop::blit_frame(GameScreen& screen) {
+  if (skip_video_) {
+    return;
+  }
+  if (os_bridge_.blit_shades) {
+    os_bridge_.blit_shades(screen.shade_data(), screen.shade_pitch());
+  }
+  if (os_bridge_.lock_frame) {
+    // Straight into the frontend's buffer, and only the lines that changed
+    const GameScreen::LineRange changed = screen.take_changed_lines();
+    size_t pitch = 0;
+    uint32_t* pixels = changed.empty() ? nullptr : os_bridge_.lock_frame(changed.first, changed.end, pitch);
+    if (pixels != nullptr) {
+      screen.convert_lines(changed, pixels, pitch);
+    } else {
+      // Nothing reached the frontend, so these lines still need showing next frame
+      screen.restore_changed_lines(changed);
+    }
+    os_bridge_.unlock_frame();
+  } else if (os_bridge_.blit_changed_lines) {
+    const GameScreen::LineRange changed = screen.take_changed_lines();
+    os_bridge_.blit_changed_lines(screen.pixel_data(), screen.pitch(), changed.first, changed.end);
+  } else if (os_bridge_.blit_screen) {
+    os_bridge_.blit_screen(screen.pixel_data(), screen.pitch());
+  }
+}
+
 bool MainLoop::run(JoypadState& joypad_state) {
   cpu_.update_joypad_state(joypad_state);
   cpu_.run_single_instruction();
 
+  // Only the real timeline gets here; run-ahead and rewind replays emulate through run_to_frame_end
+  if (boot_state_cache_ && !cpu_.mc().boot_rom_active()) {
+    store_boot_state();
+  }
+
   if (ppu_.frame_completed()) {
     apu_.generate_samples();
+    emulated_frame_count_++;
 
-    auto current_time = steady_clock::now();
-    busy_wait(current_time);
-    os_bridge_.present_frame();
-    frame_count_++;
+    if (rewind_ && ++frames_since_snapshot_ >= frames_per_snapshot_) {
+      frames_since_snapshot_ = 0;
+      record_rewind_snapshot();
+    }
+
+    if (speed_ != 1) {
+      return finish_turbo_frame();
+    }
 
-    if (frame_count_ == FPS_MEASUREMENT_INTERVAL)
-      calculate_fps();
+    if (run_ahead_frames_ > 0) {
+      run_ahead();
+    }
 
+    present_frame();
     return true;
   }
 
@@ -50,10 +117,172 @@ void MainLoop::run_once() {
   cpu_.run_single_instruction();
 }
 
+void MainLoop::emulate_frame(JoypadState& joypad_state, bool replay) {
+  cpu_.update_joypad_state(joypad_state);
+
+  const bool skip_video = skip_video_;
+  mute_audio_ = replay;
+  set_skip_video(replay);
+  run_to_frame_end();
+  apu_.generate_samples();
+  emulated_frame_count_++;
+  mute_audio_ = false;
+  set_skip_video(skip_video);
+}
+
+void MainLoop::present_frame() {
+  if (audio_rate_control_ && speed_ == 1 && os_bridge_.audio_buffer_fill) {
+    pacer_.set_audio_fill(os_bridge_.audio_buffer_fill());
+  } else {
+    pacer_.clear_audio_fill();
+  }
+  pacer_.wait_for_next_frame();
+  show_frame();
+}
+
+void MainLoop::show_frame() {
+  os_bridge_.present_frame();
+  frame_count_++;
+
+  if (frame_count_ == FPS_MEASUREMENT_INTERVAL)
+    calculate_fps();
+}
+
+void MainLoop::set_speed(uint32_t speed) {
+  speed_ = speed;
+  audio_decimator_.set_ratio(speed == UNCAPPED_SPEED ? 1.0 : speed);
+  reset_frame_visibility();
+}
+
+bool MainLoop::finish_turbo_frame() {
+  const auto now = steady_clock::now();
+  const bool presented = !skip_video_;
+  const uint32_t frames_per_present = frames_since_present_ + 1;
+
+  if (presented) {
+    if (speed_ == UNCAPPED_SPEED) {
+      // The audio has to be squeezed by however many frames fit into each real frame
+      audio_decimator_.set_ratio(frames_per_present);
+      pacer_.restart(now);
+      show_frame();
+    } else {
+      present_frame();
+    }
+    frames_since_present_ = 0;
+  } else {
+    frames_since_present_++;
+  }
+
+  // Decide whether the next frame gets drawn before emulating it, so skipped frames never draw a pixel
+  bool present_next;
+  if (speed_ == UNCAPPED_SPEED) {
+    // Draw the first frame that will finish after the next real frame is due, guessing that it takes as long
+    // to emulate as the last one
+    present_next =
+        (now - pacer_.last_frame_time()) + (now - last_frame_end_time_) >= TARGET_FRAME_DURATION_MICROSECONDS;
+  } else {
+    present_next = frames_since_present_ + 1 >= speed_;
+  }
+  last_frame_end_time_ = now;
+  set_skip_video(!present_next);
+
+  return presented;
+}
+
+void MainLoop::set_headless(bool headless) {
+  headless_ = headless;
+  set_skip_video(skip_video_);
+}
+
+void MainLoop::set_skip_video(bool skip) {
+  skip_video_ = skip;
+  ppu_.set_skip_rendering(skip || headless_);
+}
+
+void MainLoop::reset_frame_visibility() {
+  // The real frame is only drawn when nothing runs ahead of it, and turbo starts with frames it skips
+  frames_since_present_ = 0;
+  set_skip_video(speed_ != 1 || run_ahead_frames_ > 0);
+}
+
 CPU<Bus>& MainLoop::cpu() {
   return cpu_;
 }
 
+void MainLoop::enable_rewind(size_t memory_budget_bytes, uint32_t frames_per_snapshot) {
+  frames_per_snapshot_ = std::max<uint32_t>(frames_per_snapshot, 1);
+  frames_since_snapshot_ = 0;
+  rewind_.emplace(memory_budget_bytes, REWIND_KEYFRAME_INTERVAL_FRAMES / frames_per_snapshot_);
+}
+
+bool MainLoop::rewind() {
+  if (!rewind_ || !rewind_->pop(rewind_snapshot_)) {
+    pacer_.wait_for_next_frame();
+    os_bridge_.present_frame();
+    return false;
+  }
+
+  SaveStateSerializer serializer(rewind_snapshot_, true, true);
+  deserialize(serializer);
+
+  // Snapshots are taken at the end of a frame, so running on to the next frame end redraws the screen
+  mute_audio_ = true;
+  set_skip_video(false);
+  run_to_frame_end();
+  apu_.generate_samples();
+  mute_audio_ = false;
+  reset_frame_visibility();
+  frames_since_snapshot_ = 0;
+
+  present_frame();
+  return true;
+}
+
+void MainLoop::set_run_ahead(uint32_t frames) {
+  run_ahead_frames_ = frames;
+  reset_frame_visibility();
+}
+
+void MainLoop::run_ahead() {
+  auto start_time = steady_clock::now();
+
+  SaveStateSerializer save(run_ahead_snapshot_, false, true);
+  serialize(save);
+
+  mute_audio_ = true;
+  for (uint32_t frame = 1; frame <= run_ahead_frames_; frame++) {
+    set_skip_video(frame < run_ahead_frames_);
+    run_to_frame_end();
+  }
+  // Flush the run-ahead samples while still muted; the sample buffer isn't part of the snapshot
+  apu_.generate_samples();
+  mute_audio_ = false;
+  set_skip_video(true);
+
+  SaveStateSerializer load(run_ahead_snapshot_, true, true);
+  deserialize_machine(load);
+
+  total_run_ahead_time_ += duration_cast<microseconds>(steady_clock::now() - start_time);
+  run_ahead_count_++;
+}
+
+void MainLoop::run_to_frame_end() {
+  for (uint32_t i = 0; i < M_CYCLES_PER_FRAME && !ppu_.frame_completed(); i++) {
+    cpu_.run_single_instruction();
+  }
+}
+
+void MainLoop::record_rewind_snapshot() {
+  auto start_time = steady_clock::now();
+
+  SaveStateSerializer serializer(rewind_snapshot_, false, true);
+  serialize(serializer);
+  rewind_->push(rewind_snapshot_);
+
+  total_rewind_record_time_ += duration_cast<microseconds>(steady_clock::now() - start_time);
+  rewind_record_count_++;
+}
+
 void MainLoop::calculate_fps() {
   auto current_time = steady_clock::now();
   auto total_elapsed_time = current_time - last_fps_time_;
@@ -61,42 +290,162 @@ void MainLoop::calculate_fps() {
       static_cast<double>(frame_count_) / duration_cast<duration<double>>(total_elapsed_time).count();
 
   // Calculate theoretical FPS without sleep limiting
-  auto actual_render_time = total_elapsed_time - total_sleep_time_;
+  auto actual_render_time = total_elapsed_time - pacer_.waited();
   auto time_per_frame = actual_render_time / FPS_MEASUREMENT_INTERVAL;
 
   auto theoretical_fps = std::chrono::seconds(1) / time_per_frame;
 
   std::cout << "FPS: " << actual_fps << " (Actual: " << theoretical_fps << ")" << std::endl;
+  pacer_.report();
+
+  if (rewind_ && rewind_record_count_ > 0 && !rewind_->empty()) {
+    auto record_time = total_rewind_record_time_ / rewind_record_count_;
+    double frame_percent = 100.0 * record_time.count() / TARGET_FRAME_DURATION_MICROSECONDS.count();
+    double history_seconds = rewind_->size() * frames_per_snapshot_ / FRAMES_PER_SECOND;
+    double kb_per_second = rewind_->memory_used() / 1024.0 / history_seconds;
+    std::cout << "Rewind: " << record_time.count() << "us per snapshot (" << frame_percent << "% of frame), "
+              << kb_per_second << " KB per second of history, " << history_seconds << "s stored" << std::endl;
+  }
+  total_rewind_record_time_ = microseconds(0);
+  rewind_record_count_ = 0;
+
+  if (run_ahead_count_ > 0) {
+    auto run_ahead_time = total_run_ahead_time_ / run_ahead_count_;
+    double frame_percent = 100.0 * run_ahead_time.count() / TARGET_FRAME_DURATION_MICROSECONDS.count();
+    std::cout << "Run-ahead: " << run_ahead_frames_ << " frames, " << run_ahead_time.count() << "us per frame ("
+              << frame_percent << "% of frame)" << std::endl;
+  }
+  total_run_ahead_time_ = microseconds(0);
+  run_ahead_count_ = 0;
+
+  if (speed_ != 1) {
+    double achieved_speed = emulated_frame_count_ / duration_cast<duration<double>>(total_elapsed_time).count() /
+                            FRAMES_PER_SECOND;
+    std::cout << "Turbo: ";
+    if (speed_ == UNCAPPED_SPEED) {
+      std::cout << "uncapped";
+    } else {
+      std::cout << speed_ << "x";
+    }
+    std::cout << ", " << achieved_speed << "x achieved" << std::endl;
+  }
+  emulated_frame_count_ = 0;
 
   frame_count_ = 0;
   last_fps_time_ = current_time;
+}
+
+void MainLoop::serialize(SaveStateSerializer& serializer) const {
+  serializer << cpu_;
+  serializer << cpu_.mc();
+  serializer << cpu_.timer();
+  serializer << ppu_.memory();
+  serializer << ppu_;
+  serializer << apu_;
+}
 
-  total_sleep_time_ = microseconds(0);  // Reset sleep time for next measurement period
+void MainLoop::deserialize(SaveStateSerializer& serializer) {
+  boot_state_cache_ = nullptr;
+  deserialize_machine(serializer);
 }
 
-void MainLoop::busy_wait(time_point<steady_clock> current_time) {
-  auto frame_elapsed = current_time - last_present_time_;
+void MainLoop::deserialize_machine(SaveStateSerializer& serializer) {
+  serializer >> cpu_;
+  serializer >> cpu_.mc();
+  serializer >> cpu_.timer();
+  serializer >> ppu_.memory();
+  serializer >> ppu_;
+  serializer >> apu_;
+}
 
-  if (frame_elapsed < TARGET_FRAME_DURATION_MICROSECONDS) {
-    auto sleep_duration = TARGET_FRAME_DURATION_MICROSECONDS - frame_elapsed;
-    auto end = current_time + sleep_duration;
-    total_sleep_time_ += duration_cast<microseconds>(sleep_duration);
+void MainLoop::save_sections(SaveStateWriter& writer) const {
+  writer.add_section(SaveStateSection::CPU, cpu_);
+  writer.add_section(SaveStateSection::MemoryController, cpu_.mc());
+  writer.add_section(SaveStateSection::Timer, cpu_.timer());
+  writer.add_section(SaveStateSection::PPUMemory, ppu_.memory());
+  writer.add_section(PPU_SECTION, ppu_);
+  writer.add_section(SaveStateSection::APU, apu_);
+}
 
-    while (steady_clock::now() < end) {}
-    last_present_time_ += TARGET_FRAME_DURATION_MICROSECONDS;
-  } else {
-    last_present_time_ = current_time;
+void MainLoop::load_sections(SaveStateReader& reader) {
+  check_sections(reader);
+
+  // A section's data can still turn out corrupt partway through, after others have been applied. The copy kept to
+  // put back includes the ROM banks, which a snapshot leaves out but a MemoryController section overwrites.
+  std::vector<uint8_t> previous;
+  SaveStateSerializer save(previous, false, false);
+  serialize(save);
+  try {
+    reader.read_section(SaveStateSection::CPU, cpu_);
+    reader.read_section(SaveStateSection::MemoryController, cpu_.mc());
+    reader.read_section(SaveStateSection::Timer, cpu_.timer());
+    reader.read_section(SaveStateSection::PPUMemory, ppu_.memory());
+    reader.read_section(PPU_SECTION, ppu_);
+    reader.read_section(SaveStateSection::APU, apu_);
+  } catch (...) {
+    SaveStateSerializer load(previous, true, false);
+    deserialize_machine(load);
+    throw;
   }
+  boot_state_cache_ = nullptr;
 }
 
-void MainLoop::serialize(SaveStateSerializer& serializer) const {
+void MainLoop::check_sections(const SaveStateReader& reader) {
+  reader.require_section(SaveStateSection::CPU, CPU<Bus>::SAVE_STATE_VERSION);
+  reader.require_section(SaveStateSection::MemoryController, MemoryController::SAVE_STATE_VERSION);
+  reader.require_section(SaveStateSection::Timer, Timer::SAVE_STATE_VERSION);
+  reader.require_section(SaveStateSection::PPUMemory, PPUMemory::SAVE_STATE_VERSION);
+  reader.require_section(PPU_SECTION, PPU::SAVE_STATE_VERSION);
+  reader.require_section(SaveStateSection::APU, APU::SAVE_STATE_VERSION);
+}
+
+uint64_t MainLoop::state_hash(StateHashMode mode) {
+  if (mode == StateHashMode::Full) {
+    cpu_.mc().invalidate_state_hash();
+    ppu_.memory().invalidate_state_hash();
+  }
+
+  // The remaining components are small, so hashing their snapshot serialization costs about as much as
+  // tracking writes to them would
+  SaveStateSerializer serializer(state_hash_buffer_, false, true);
   serializer << cpu_;
-  serializer << apu_;
+  serializer << cpu_.timer();
   serializer << ppu_;
+  serializer << apu_;
+
+  uint64_t hash = hash_bytes(state_hash_buffer_);
+  hash = cpu_.mc().state_hash(hash);
+  return ppu_.memory().state_hash(hash);
 }
 
-void MainLoop::deserialize(SaveStateSerializer& serializer) {
-  serializer >> cpu_;
-  serializer >> apu_;
-  serializer >> ppu_;
+void MainLoop::load_boot_state(std::span<const uint8_t> state) {
+  SaveStateReader reader(state);
+  reader.read_section(SaveStateSection::CPU, cpu_);
+  reader.read_section(SaveStateSection::BootMemory, MemoryController::BOOT_STATE_VERSION,
+                      [&](SaveStateSerializer& serializer) { cpu_.mc().deserialize_boot_state(serializer); });
+  reader.read_section(SaveStateSection::Timer, cpu_.timer());
+  reader.read_section(SaveStateSection::PPUMemory, ppu_.memory());
+  reader.read_section(PPU_SECTION, ppu_);
+  reader.read_section(SaveStateSection::APU, apu_);
+}
+
+void MainLoop::record_boot_state(BootStateCache& cache, uint64_t key) {
+  boot_state_cache_ = &cache;
+  boot_state_key_ = key;
+}
+
+void MainLoop::store_boot_state() {
+  SaveStateWriter writer;
+  writer.add_section(SaveStateSection::CPU, cpu_);
+  writer.add_section(SaveStateSection::BootMemory, MemoryController::BOOT_STATE_VERSION,
+                     [&](SaveStateSerializer& serializer) { cpu_.mc().serialize_boot_state(serializer); });
+  writer.add_section(SaveStateSection::Timer, cpu_.timer());
+  writer.add_section(SaveStateSection::PPUMemory, ppu_.memory());
+  writer.add_section(PPU_SECTION, ppu_);
+  writer.add_section(SaveStateSection::APU, apu_);
+
+  std::vector<uint8_t> state;
+  writer.write_to(state);
+  boot_state_cache_->store(boot_state_key_, std::move(state));
+  boot_state_cache_ = nullptr;
 }
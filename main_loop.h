@@ -2,37 +2,139 @@
 
 #include <inttypes.h>
 #include <chrono>
+#include <optional>
+#include <span>
+#include <vector>
 #include "OSBridge.h"
 #include "apu.h"
+#include "audio_decimator.h"
 #include "bus.h"
 #include "cpu.h"
+#include "frame_pacer.h"
 #include "ppu.h"
 #include "ppu_bridge.h"
+#include "rewind_buffer.h"
 
+class BootStateCache;
 class ROMLoader;
+class SaveStateReader;
+class SaveStateWriter;
+
+enum class StateHashMode {
+  Incremental,  // Reuse the hashes of memory pages not written since the last call
+  Full,         // Rehash everything, e.g. to check the incremental hash
+};
 
 class MainLoop {
 public:
+  static constexpr uint32_t UNCAPPED_SPEED = 0;  // For set_speed: as fast as the host can go
+
   MainLoop(ROMLoader& loader, OSBridge& bridge);
   bool run(JoypadState& joypad_state);
   void run_once();
+  // Emulate one whole frame with the given input, without pacing or presenting it, for callers that schedule
+  // frames themselves such as netplay. Replayed frames are emulated again after a rollback, so they are
+  // neither drawn nor heard.
+  void emulate_frame(JoypadState& joypad_state, bool replay = false);
+  // Wait for the next frame slot and show the last frame drawn
+  void present_frame();
   CPU<Bus>& cpu();
 
+  // Flat serialization of the whole machine, used for in-memory snapshots. Restoring one, like loading a state,
+  // stops record_boot_state, since the machine no longer follows a plain boot.
   void serialize(SaveStateSerializer& serializer) const;
   void deserialize(SaveStateSerializer& serializer);
 
+  // One save state file section per component. Loading is all or nothing: a state with a section missing, too new
+  // or unreadable throws and leaves the machine as it was.
+  void save_sections(SaveStateWriter& writer) const;
+  void load_sections(SaveStateReader& reader);
+  // Throws unless every section load_sections reads is there in a version it can read
+  static void check_sections(const SaveStateReader& reader);
+
+  // 64-bit hash of all guest-visible state: CPU and I/O registers, WRAM, HRAM, VRAM, OAM, cart RAM and the
+  // timer/PPU/APU internals. Cheap enough to call every frame to check replays and round trips are exact.
+  uint64_t state_hash(StateHashMode mode = StateHashMode::Incremental);
+
+  // Apply a state captured by record_boot_state instead of running the boot ROM. Throws std::runtime_error if
+  // the state can't be used, possibly after part of it has been applied.
+  void load_boot_state(std::span<const uint8_t> state);
+  // Store the machine state in the cache as soon as the boot ROM unmaps itself
+  void record_boot_state(BootStateCache& cache, uint64_t key);
+
+  // Record a snapshot every frames_per_snapshot frames, keeping as much history as fits in the budget
+  void enable_rewind(size_t memory_budget_bytes, uint32_t frames_per_snapshot);
+  // Restore the newest recorded snapshot and run it to the end of its frame. Returns false once there is no
+  // history left, in which case the current frame is just presented again.
+  bool rewind();
+
+  // Each frame, emulate this many frames further with the current input, show the last of them and return to
+  // the real frame. Hides input lag built into games at the cost of emulating frames + 1 frames per frame.
+  void set_run_ahead(uint32_t frames);
+
+  // Never draw pixels, for runs nobody watches such as tests and batch jobs. Emulation is unaffected, since
+  // skipped rendering keeps everything that drawing does to timing; blit_screen is still called each frame.
+  void set_headless(bool headless);
+
+  // Draw scanlines on a second thread, pipelined behind emulation. Frames are identical either way.
+  void set_render_thread(bool enabled) { ppu_.set_render_thread(enabled); }
+
+  // Run speed times faster than real time, presenting one frame per real frame and squeezing the audio into
+  // real time. Frames that aren't presented skip drawing pixels. 1 is normal speed. Run-ahead is off meanwhile.
+  void set_speed(uint32_t speed);
+
+  // Follow the audio device's buffer through OSBridge::audio_buffer_fill, running up to 0.5% fast or slow to keep
+  // it at its target, rather than pacing by the clock alone. Only at normal speed, and only if the bridge has it.
+  void set_audio_rate_control(bool enabled) { audio_rate_control_ = enabled; }
+
 private:
-  void busy_wait(std::chrono::time_point<std::chrono::steady_clock> current_time);
+  void blit_frame(GameScreen& screen);
   void calculate_fps();
+  void record_rewind_snapshot();
+  void store_boot_state();
+  // Restore a snapshot taken on the real timeline, which keeps recording the boot state
+  void deserialize_machine(SaveStateSerializer& serializer);
+  void run_ahead();
+  void run_to_frame_end();
+  void show_frame();
+  bool finish_turbo_frame();
+  void set_skip_video(bool skip);
+  void reset_frame_visibility();
 
   CPU<Bus> cpu_;
   PPUBridge ppu_bridge_;
   PPU ppu_;
   APU apu_;
   Bus bus_;
-  std::chrono::steady_clock::time_point last_present_time_ = std::chrono::steady_clock::now();
+  FramePacer pacer_;
+  bool audio_rate_control_ = false;
   std::chrono::steady_clock::time_point last_fps_time_ = std::chrono::steady_clock::now();
   uint32_t frame_count_ = 0;
-  std::chrono::microseconds total_sleep_time_ = std::chrono::microseconds(0);
   OSBridge os_bridge_;
+
+  std::optional<RewindBuffer> rewind_;
+  std::vector<uint8_t> rewind_snapshot_;  // Reused between snapshots to avoid reallocating
+  uint32_t frames_per_snapshot_ = 1;
+  uint32_t frames_since_snapshot_ = 0;
+  bool mute_audio_ = false;  // Set while replaying rewound frames or running ahead
+  bool skip_video_ = false;  // Set for frames that are emulated but never shown
+  bool headless_ = false;
+  std::chrono::microseconds total_rewind_record_time_ = std::chrono::microseconds(0);
+  uint32_t rewind_record_count_ = 0;
+
+  std::vector<uint8_t> run_ahead_snapshot_;  // The real frame, reused between frames to avoid reallocating
+  uint32_t run_ahead_frames_ = 0;
+  std::chrono::microseconds total_run_ahead_time_ = std::chrono::microseconds(0);
+  uint32_t run_ahead_count_ = 0;
+
+  uint32_t speed_ = 1;
+  uint32_t frames_since_present_ = 0;  // Emulated but unpresented frames while running faster than real time
+  uint32_t emulated_frame_count_ = 0;  // Frames emulated since the last FPS measurement
+  std::chrono::steady_clock::time_point last_frame_end_time_ = std::chrono::steady_clock::now();
+  AudioDecimator audio_decimator_;
+
+  BootStateCache* boot_state_cache_ = nullptr;  // Set while waiting for the boot ROM to finish
+  uint64_t boot_state_key_ = 0;
+
+  std::vector<uint8_t> state_hash_buffer_;  // Serialized CPU/timer/PPU/APU state, reused between calls
 };
@@ -1,4 +1,7 @@
 #include "bank_registers.h"
+#include <array>
+#include "save_state.h"
+#include "state_hash.h"
 #include "utils.h"
 
 // ===== MBC Register Constants =====
@@ -35,11 +38,16 @@ constexpr uint8_t MBC2_RAM_ENABLE_MASK = 0x0F;
 // Bit shifts
 constexpr uint8_t BANK2_SHIFT_MBC1 = 5;
 constexpr uint8_t BANK2_SHIFT_MBC5 = 8;
+
+// Bytes after the writable registers when the whole object was copied (save state versions before 2): the two
+// masks, a padding byte and the ROM type
+constexpr uint32_t RAW_LAYOUT_TAIL_SIZE = 7;
 }  // namespace MBCConstants
 
 BankRegisters::BankRegisters(uint32_t rom_bank_count, uint32_t ram_bank_count, ROMType rom_type)
     : rom_bank_mask_(static_cast<uint8_t>(rom_bank_count - 1)),
-      ram_bank_mask_(static_cast<uint8_t>(ram_bank_count - 1)),
+      // Carts without RAM never select past bank 0, so the rest of the RAM banks stay untouched
+      ram_bank_mask_(static_cast<uint8_t>(ram_bank_count > 1 ? ram_bank_count - 1 : 0)),
       rom_type_(rom_type) {}
 
 void BankRegisters::write(uint16_t address, uint8_t value) {
@@ -120,4 +128,29 @@ bool BankRegisters::get_bankMode() const {
 
 ROMType BankRegisters::rom_type() const {
   return rom_type_;
-}
\ No newline at end of file
+}
+
+void BankRegisters::serialize(SaveStateSerializer& serializer) const {
+  serializer << bank1_;
+  serializer << bank2_;
+  serializer << bankRAM_;
+  serializer << bankMode_;
+  serializer << ramEnabled_;
+}
+
+void BankRegisters::deserialize(SaveStateSerializer& serializer) {
+  serializer >> bank1_;
+  serializer >> bank2_;
+  serializer >> bankRAM_;
+  serializer >> bankMode_;
+  serializer >> ramEnabled_;
+  if (serializer.section_older_than(2)) {
+    std::array<uint8_t, MBCConstants::RAW_LAYOUT_TAIL_SIZE> tail;
+    serializer >> tail;
+  }
+}
+
+uint64_t BankRegisters::state_hash(uint64_t seed) const {
+  const std::array<uint8_t, 5> registers = {bank1_, bank2_, bankRAM_, bankMode_, ramEnabled_};
+  return hash_object(registers, seed);
+}
@@ -3,6 +3,8 @@
 #include <inttypes.h>
 #include "mbc.h"
 
+class SaveStateSerializer;
+
 class BankRegisters {
 public:
   BankRegisters(uint32_t rom_bank_count, uint32_t ram_bank_count, ROMType rom_type);
@@ -15,6 +17,11 @@ public:
   bool get_ram_enabled() const;
   ROMType rom_type() const;
 
+  // Only the registers the game writes; the masks and ROM type come from the cartridge header
+  void serialize(SaveStateSerializer& serializer) const;
+  void deserialize(SaveStateSerializer& serializer);
+  uint64_t state_hash(uint64_t seed) const;
+
 private:
   uint8_t bank1_ = 1;
   uint8_t bank2_ = 0;
@@ -45,9 +45,9 @@ void MemoryController::load_rom(ROMLoader& loader) {
            MemoryControllerConstants::ROM_BANK_SIZE);
   }
 
+  ram_bank_count_ = loader.ram_bank_count();
   if (loader.has_battery()) {
     ram_filename_ = loader.ram_filename();
-    ram_bank_count_ = loader.ram_bank_count();
 
     if (loader.ram_size() == ram_bank_count_ * MemoryControllerConstants::RAM_BANK_SIZE) {
       std::cout << "MemoryController: Loading " << loader.ram_size() << " bytes of RAM data" << std::endl;
@@ -76,29 +76,88 @@ void MemoryController::load_rom(ROMLoader& loader) {
 }
 
 void MemoryController::serialize(SaveStateSerializer& serializer) const {
-  serializer << registers_;
+  serializer << ram_bank_count_;
+  for (size_t i = 0; i < ram_banks_in_use(); i++) {
+    serializer << ramBanks_[i];
+  }
+  registers_.serialize(serializer);
   serializer << mbc_type_;
   serializer << tickCount_;
   serializer << WRAM_;
   serializer << HRAM_;
-  serializer << memoryBanks_;
-  serializer << ramBanks_;
+  if (!serializer.is_snapshot()) {
+    serializer << memoryBanks_;
+  }
   serializer << ram_filename_;
-  serializer << ram_bank_count_;
+  serializer << bootROMActive_;
+  if (!serializer.is_snapshot()) {
+    serializer << bootROM_;
+  }
 
   //Need to reset ROMbank00_ and ROMbankNN_ and RAMbank_ pointers
 }
 
 void MemoryController::deserialize(SaveStateSerializer& serializer) {
-  serializer >> registers_;
+  if (serializer.section_older_than(2)) {
+    // Version 1 wrote every bank, and a bank count only for carts with a battery, so the count of the loaded
+    // cartridge is kept
+    uint8_t ram_bank_count;
+    serializer >> ramBanks_;
+    serializer >> ram_bank_count;
+  } else {
+    serializer >> ram_bank_count_;
+    for (size_t i = 0; i < ram_banks_in_use(); i++) {
+      serializer >> ramBanks_[i];
+    }
+  }
+  registers_.deserialize(serializer);
   serializer >> mbc_type_;
   serializer >> tickCount_;
   serializer >> WRAM_;
   serializer >> HRAM_;
-  serializer >> memoryBanks_;
-  serializer >> ramBanks_;
+  if (!serializer.is_snapshot()) {
+    serializer >> memoryBanks_;
+  }
   serializer >> ram_filename_;
-  serializer >> ram_bank_count_;
+  // Versions before 3 didn't record the boot ROM, which is almost always unmapped by the time a state is saved.
+  // read_rom0 maps it over 0x0000-0x00FF by this flag alone, so restoring the flag restores the mapping.
+  if (serializer.section_older_than(3)) {
+    bootROMActive_ = false;
+  } else {
+    serializer >> bootROMActive_;
+    if (!serializer.is_snapshot()) {
+      serializer >> bootROM_;
+    }
+  }
 
   refresh_bank_map();
+  invalidate_state_hash();
+}
+
+void MemoryController::serialize_boot_state(SaveStateSerializer& serializer) const {
+  serializer << tickCount_;
+  serializer << WRAM_;
+  serializer << HRAM_;
+}
+
+void MemoryController::deserialize_boot_state(SaveStateSerializer& serializer) {
+  serializer >> tickCount_;
+  serializer >> WRAM_;
+  serializer >> HRAM_;
+  bootROMActive_ = false;
+  invalidate_state_hash();
+}
+
+uint64_t MemoryController::state_hash(uint64_t seed) {
+  uint64_t hash = hash_object(wram_hash_.hash(WRAM_.data()), seed);
+  const size_t cart_ram_size = ram_banks_in_use() * MemoryControllerConstants::RAM_BANK_SIZE;
+  hash = hash_object(cart_ram_hash_.hash(ramBanks_[0].data(), cart_ram_size), hash);
+  hash = hash_object(HRAM_, hash);
+  hash = registers_.state_hash(hash);
+  return hash_object(bootROMActive_, hash);
+}
+
+void MemoryController::invalidate_state_hash() {
+  wram_hash_.mark_all();
+  cart_ram_hash_.mark_all();
 }
@@ -1,6 +1,7 @@
 #pragma once
 
 #include <inttypes.h>
+#include <algorithm>
 #include <array>
 #include <fstream>
 #include <functional>
@@ -8,6 +9,7 @@
 #include <vector>
 #include "bank_registers.h"
 #include "constants.h"
+#include "state_hash.h"
 
 class ROMLoader;
 class CPURegisters;
@@ -48,6 +50,8 @@ public:
     RAMbank_ = &ramBanks_[registers_.get_ram0()];
   }
 
+  bool boot_rom_active() const { return bootROMActive_; }
+
   void unload_boot_rom() {
     bootROMActive_ = false;
     std::cout << "MemoryController: Unloaded boot ROM" << std::endl;
@@ -93,6 +97,8 @@ public:
         value |= UPPER_NIBBLE_MASK;
       }
       (*RAMbank_)[addr - EXTERNAL_RAM_START] = value;
+      cart_ram_hash_.mark((RAMbank_ - ramBanks_.data()) * MemoryControllerConstants::RAM_BANK_SIZE + addr -
+                          EXTERNAL_RAM_START);
       ramDirty_ = true;
 
       write_callback(addr, value);
@@ -100,17 +106,37 @@ public:
   }
 
   const uint8_t* read_wram(uint16_t addr) const { return &WRAM_[addr - WRAM_START]; }
-  void write_wram(uint16_t addr, uint8_t value) { WRAM_[addr - WRAM_START] = value; }
+  void write_wram(uint16_t addr, uint8_t value) {
+    WRAM_[addr - WRAM_START] = value;
+    wram_hash_.mark(addr - WRAM_START);
+  }
 
   const uint8_t* read_hram(uint16_t addr) const { return &HRAM_[addr - HRAM_START]; }
   void write_hram(uint16_t addr, uint8_t value) { HRAM_[addr - HRAM_START] = value; }
 
+  // Cart RAM comes first in the serialized layout, after its bank count, so tools can read it straight out of a
+  // save state section. Only the banks in use are written. Whether the boot ROM is mapped over 0x0000-0x00FF is
+  // restored too, so states taken during boot resume in it.
+  static constexpr uint32_t SAVE_STATE_VERSION = 3;
   void serialize(SaveStateSerializer& serializer) const;
   void deserialize(SaveStateSerializer& serializer);
 
+  // Just what the boot ROM changes. Cartridge RAM, banking and the RAM file belong to the cartridge and are
+  // left as loaded, and the boot ROM is unmapped since the state is taken after it finishes.
+  static constexpr uint32_t BOOT_STATE_VERSION = 1;
+  void serialize_boot_state(SaveStateSerializer& serializer) const;
+  void deserialize_boot_state(SaveStateSerializer& serializer);
+
+  // Guest-visible state only, so the RAM file bookkeeping is left out. Only rehashes memory written since the
+  // last call.
+  uint64_t state_hash(uint64_t seed);
+  void invalidate_state_hash();
+
 private:
   void initialise_ram();
   void load_rom(ROMLoader& loader);
+  // Bank 0 is always backed, as RAM writes on carts without RAM (and MBC2's built-in RAM) land there
+  size_t ram_banks_in_use() const { return std::clamp<size_t>(ram_bank_count_, 1, ramBanks_.size()); }
   uint8_t mbc_type_;
 
   std::array<unsigned char, MemoryControllerConstants::ROM_BANK_SIZE>* ROMbank00_ = nullptr;
@@ -120,7 +146,7 @@ private:
   std::array<unsigned char, MemoryControllerConstants::WRAM_SIZE> WRAM_;
   std::array<unsigned char, MemoryControllerConstants::HRAM_SIZE> HRAM_;
   std::vector<std::array<unsigned char, MemoryControllerConstants::ROM_BANK_SIZE>> memoryBanks_;
-  std::array<std::array<unsigned char, MemoryControllerConstants::RAM_BANK_SIZE>, 4> ramBanks_;
+  std::array<std::array<unsigned char, MemoryControllerConstants::RAM_BANK_SIZE>, 4> ramBanks_ = {};
 
   std::array<unsigned char, MemoryControllerConstants::BOOT_ROM_SIZE> bootROM_ = {0};
   bool bootROMActive_ = false;
@@ -133,4 +159,7 @@ private:
   uint8_t ram_bank_count_ = 0;
   std::string ram_filename_;
   uint32_t tickCount_ = 0;
+
+  PagedHash<MemoryControllerConstants::WRAM_SIZE> wram_hash_;
+  PagedHash<MemoryControllerConstants::RAM_BANK_SIZE * 4> cart_ram_hash_;
 };
@@ -0,0 +1,257 @@
+#include "netplay_session.h"
+#include <algorithm>
+#include <cstring>
+#include <iostream>
+#include "main_loop.h"
+#include "rom_header.h"
+#include "save_state.h"
+#include "state_hash.h"
+
+// ===== Netplay Packet Layout =====
+// Every packet carries the sender's input from the first frame the receiver hasn't acknowledged up to the
+// newest, so a lost packet is made up for by the next one and nothing is ever resent.
+//   0  magic         u32
+//   4  session key   u64
+//   12 first frame   u32   Frame of the first input byte
+//   16 ack frame     u32   The sender has the receiver's input for all frames before this
+//   20 input count   u16
+//   22 inputs        one byte per frame, bits as in pack_input
+namespace {
+constexpr uint32_t PACKET_MAGIC = 0x504E4247;  // "GBNP"
+constexpr size_t PACKET_HEADER_SIZE = 22;
+constexpr uint32_t MAX_INPUTS_PER_PACKET = 32;
+constexpr size_t MAX_PACKET_SIZE = 512;
+constexpr uint32_t STATS_LOG_INTERVAL = 300;  // Host frames between stats log lines
+
+template <typename T>
+void write_field(std::vector<uint8_t>& packet, size_t offset, T value) {
+  memcpy(packet.data() + offset, &value, sizeof(value));
+}
+
+template <typename T>
+T read_field(const std::vector<uint8_t>& packet, size_t offset) {
+  T value;
+  memcpy(&value, packet.data() + offset, sizeof(value));
+  return value;
+}
+
+uint8_t pack_input(const JoypadState& state) {
+  return static_cast<uint8_t>(state.a_pressed << 0 | state.b_pressed << 1 | state.select_pressed << 2 |
+                              state.start_pressed << 3 | state.right_pressed << 4 | state.left_pressed << 5 |
+                              state.up_pressed << 6 | state.down_pressed << 7);
+}
+
+JoypadState unpack_input(uint8_t input) {
+  JoypadState state;
+  state.a_pressed = input & 0x01;
+  state.b_pressed = input & 0x02;
+  state.select_pressed = input & 0x04;
+  state.start_pressed = input & 0x08;
+  state.right_pressed = input & 0x10;
+  state.left_pressed = input & 0x20;
+  state.up_pressed = input & 0x40;
+  state.down_pressed = input & 0x80;
+  return state;
+}
+}  // namespace
+
+NetplaySession::NetplaySession(MainLoop& loop, const ROMHeader& rom_header, uint16_t local_port,
+                               uint32_t input_delay)
+    : loop_(loop),
+      socket_(local_port),
+      session_key_(session_key(loop, rom_header)),
+      receive_buffer_(MAX_PACKET_SIZE) {
+  // Input for the frames before the first delayed input is known to be empty
+  local_input_end_ = std::min(input_delay, MAX_INPUT_DELAY);
+}
+
+uint64_t NetplaySession::session_key(MainLoop& loop, const ROMHeader& rom_header) {
+  // The header, global checksum included, tells different ROMs apart even before they have run far enough for
+  // their states to differ
+  return hash_object(rom_header, loop.state_hash(StateHashMode::Full));
+}
+
+void NetplaySession::connect(const std::string& host, uint16_t port) {
+  socket_.connect(host, port);
+}
+
+void NetplaySession::set_on_frame_confirmed(std::function<void(uint32_t, uint64_t)> on_frame_confirmed) {
+  on_frame_confirmed_ = std::move(on_frame_confirmed);
+}
+
+void NetplaySession::simulate_network(uint32_t latency_frames, uint32_t jitter_frames, double loss_rate,
+                                      uint32_t seed) {
+  latency_frames_ = latency_frames;
+  jitter_frames_ = jitter_frames;
+  loss_rate_ = loss_rate;
+  network_random_.seed(seed);
+}
+
+bool NetplaySession::advance_frame(JoypadState& local_input) {
+  stats_.host_frames++;
+
+  receive_inputs();
+  if (rollback_pending_) {
+    roll_back();
+  }
+
+  // Snapshots only go back MAX_ROLLBACK_FRAMES, so don't get further ahead of the remote input than that
+  const bool stalled = frame_ >= remote_input_end_ + MAX_ROLLBACK_FRAMES;
+  if (stalled) {
+    stats_.stalls++;
+  } else {
+    local_inputs_[local_input_end_ % INPUT_HISTORY] = pack_input(local_input);
+    local_input_end_++;
+    emulate_frame(false);
+    stats_.frames++;
+  }
+
+  report_confirmed_frames();
+  send_inputs();
+  flush_delayed_packets();
+
+  if (stats_.host_frames % STATS_LOG_INTERVAL == 0) {
+    log_stats();
+  }
+  return !stalled;
+}
+
+void NetplaySession::receive_inputs() {
+  while (size_t size = socket_.receive(receive_buffer_)) {
+    if (size < PACKET_HEADER_SIZE || read_field<uint32_t>(receive_buffer_, 0) != PACKET_MAGIC) {
+      continue;
+    }
+    if (read_field<uint64_t>(receive_buffer_, 4) != session_key_) {
+      if (!reported_key_mismatch_) {
+        std::cerr << "Netplay: Ignoring packets from a peer that started from a different state" << std::endl;
+        reported_key_mismatch_ = true;
+      }
+      continue;
+    }
+    const uint32_t first_frame = read_field<uint32_t>(receive_buffer_, 12);
+    const uint32_t ack_frame = read_field<uint32_t>(receive_buffer_, 16);
+    const uint16_t count = read_field<uint16_t>(receive_buffer_, 20);
+    if (size < PACKET_HEADER_SIZE + count) {
+      continue;
+    }
+    stats_.packets_received++;
+    peer_ack_ = std::max(peer_ack_, std::min(ack_frame, local_input_end_));
+
+    for (uint32_t i = 0; i < count; i++) {
+      const uint32_t frame = first_frame + i;
+      if (frame < remote_input_end_) {
+        continue;
+      }
+      // Inputs only arrive in order, and never so far ahead that they'd overwrite history still needed
+      if (frame > remote_input_end_ || frame >= frame_ + INPUT_HISTORY - SNAPSHOT_COUNT) {
+        break;
+      }
+
+      const uint8_t input = receive_buffer_[PACKET_HEADER_SIZE + i];
+      remote_inputs_[frame % INPUT_HISTORY] = input;
+      remote_input_end_++;
+      if (frame < frame_ && input != predicted_inputs_[frame % INPUT_HISTORY] && !rollback_pending_) {
+        rollback_frame_ = frame;
+        rollback_pending_ = true;
+      }
+    }
+  }
+}
+
+void NetplaySession::send_inputs() {
+  const uint32_t first_frame =
+      std::max(peer_ack_, local_input_end_ - std::min(local_input_end_, MAX_INPUTS_PER_PACKET));
+  const uint32_t count = local_input_end_ - first_frame;
+
+  send_buffer_.resize(PACKET_HEADER_SIZE + count);
+  write_field(send_buffer_, 0, PACKET_MAGIC);
+  write_field(send_buffer_, 4, session_key_);
+  write_field(send_buffer_, 12, first_frame);
+  write_field(send_buffer_, 16, remote_input_end_);
+  write_field(send_buffer_, 20, static_cast<uint16_t>(count));
+  for (uint32_t i = 0; i < count; i++) {
+    send_buffer_[PACKET_HEADER_SIZE + i] = local_inputs_[(first_frame + i) % INPUT_HISTORY];
+  }
+
+  stats_.packets_sent++;
+  if (loss_rate_ > 0.0 && std::uniform_real_distribution<double>(0.0, 1.0)(network_random_) < loss_rate_) {
+    stats_.packets_dropped++;
+    return;
+  }
+  if (latency_frames_ == 0 && jitter_frames_ == 0) {
+    socket_.send(send_buffer_);
+    return;
+  }
+  const uint32_t jitter = std::uniform_int_distribution<uint32_t>(0, jitter_frames_)(network_random_);
+  delayed_packets_.push_back({stats_.host_frames + latency_frames_ + jitter, send_buffer_});
+}
+
+void NetplaySession::flush_delayed_packets() {
+  std::erase_if(delayed_packets_, [&](const DelayedPacket& packet) {
+    if (packet.release_frame > stats_.host_frames) {
+      return false;
+    }
+    socket_.send(packet.data);
+    return true;
+  });
+}
+
+void NetplaySession::roll_back() {
+  const uint32_t end_frame = frame_;
+  {
+    SaveStateSerializer serializer(snapshots_[rollback_frame_ % SNAPSHOT_COUNT], true, true);
+    loop_.deserialize(serializer);
+  }
+  frame_ = rollback_frame_;
+  rollback_pending_ = false;
+
+  stats_.rollbacks++;
+  stats_.max_rollback_frames = std::max(stats_.max_rollback_frames, end_frame - frame_);
+  while (frame_ < end_frame) {
+    emulate_frame(true);
+    stats_.resimulated_frames++;
+  }
+}
+
+void NetplaySession::emulate_frame(bool replay) {
+  const uint32_t slot = frame_ % SNAPSHOT_COUNT;
+  SaveStateSerializer serializer(snapshots_[slot], false, true);
+  loop_.serialize(serializer);
+
+  const uint8_t remote = remote_input(frame_);
+  predicted_inputs_[frame_ % INPUT_HISTORY] = remote;
+  JoypadState input = unpack_input(local_inputs_[frame_ % INPUT_HISTORY] | remote);
+  loop_.emulate_frame(input, replay);
+
+  if (on_frame_confirmed_) {
+    frame_hashes_[slot] = loop_.state_hash();
+  }
+  frame_++;
+}
+
+uint8_t NetplaySession::remote_input(uint32_t frame) const {
+  if (frame < remote_input_end_) {
+    return remote_inputs_[frame % INPUT_HISTORY];
+  }
+  // Players mostly hold buttons for many frames, so the last known input is the best guess
+  return remote_input_end_ > 0 ? remote_inputs_[(remote_input_end_ - 1) % INPUT_HISTORY] : 0;
+}
+
+void NetplaySession::report_confirmed_frames() {
+  const uint32_t confirmed_end = std::min(remote_input_end_, frame_);
+  for (; confirmed_frame_end_ < confirmed_end; confirmed_frame_end_++) {
+    if (on_frame_confirmed_) {
+      on_frame_confirmed_(confirmed_frame_end_, frame_hashes_[confirmed_frame_end_ % SNAPSHOT_COUNT]);
+    }
+  }
+}
+
+void NetplaySession::log_stats() {
+  const uint32_t host_frames = stats_.host_frames - logged_stats_.host_frames;
+  const uint32_t resimulated_frames = stats_.resimulated_frames - logged_stats_.resimulated_frames;
+  std::cout << "Netplay: frame " << frame_ << ", " << stats_.rollbacks - logged_stats_.rollbacks << " rollbacks, "
+            << static_cast<double>(resimulated_frames) / host_frames << " frames re-simulated per frame (max "
+            << stats_.max_rollback_frames << "), " << stats_.stalls - logged_stats_.stalls << " stalls, "
+            << stats_.packets_received - logged_stats_.packets_received << " packets received" << std::endl;
+  logged_stats_ = stats_;
+}
@@ -0,0 +1,115 @@
+#pragma once
+
+#include <array>
+#include <cstdint>
+#include <functional>
+#include <random>
+#include <string>
+#include <vector>
+#include "joypad_state.h"
+#include "udp_socket.h"
+
+class MainLoop;
+struct ROMHeader;
+
+struct NetplayStats {
+  uint32_t host_frames = 0;         // Calls to advance_frame
+  uint32_t frames = 0;              // Frames emulated for the first time
+  uint32_t resimulated_frames = 0;  // Frames emulated again after a misprediction
+  uint32_t rollbacks = 0;
+  uint32_t max_rollback_frames = 0;
+  uint32_t stalls = 0;              // Host frames spent waiting for the peer to catch up
+  uint32_t packets_sent = 0;
+  uint32_t packets_received = 0;
+  uint32_t packets_dropped = 0;     // By simulate_network
+};
+
+// Shared-control netplay with GGPO-style rollback: both peers run the same machine and the input of each frame
+// is both players' buttons combined. Each peer sends its input over UDP as soon as it is known and carries on
+// with a prediction of the other's (their last known input). When the real input turns out different, the
+// machine is restored to the snapshot of the first mispredicted frame and those frames are emulated again.
+//
+// Both peers must start from the same state and call advance_frame once per host frame. A peer that gets
+// MAX_ROLLBACK_FRAMES ahead of the other's input stops advancing until it catches up.
+class NetplaySession {
+public:
+  static constexpr uint32_t MAX_ROLLBACK_FRAMES = 8;
+  static constexpr uint32_t MAX_INPUT_DELAY = 8;
+
+  // Binds the local UDP port, 0 for any free port. Throws std::runtime_error if it can't.
+  // input_delay frames of delay on local input let short round trips finish without any rollback.
+  NetplaySession(MainLoop& loop, const ROMHeader& rom_header, uint16_t local_port, uint32_t input_delay);
+
+  // Identifies the ROM and the starting state. Peers only accept each other's packets if their keys match.
+  static uint64_t session_key(MainLoop& loop, const ROMHeader& rom_header);
+  uint64_t session_key() const { return session_key_; }
+
+  uint16_t local_port() const { return socket_.local_port(); }
+  // Throws std::runtime_error if host can't be resolved
+  void connect(const std::string& host, uint16_t port);
+
+  // Receive the peer's input, roll back if it was mispredicted, then emulate the next frame with local_input.
+  // Returns false if the peer is too far behind, in which case local_input is not used and no frame is emulated.
+  bool advance_frame(JoypadState& local_input);
+
+  // Called with the state hash of each frame once both players' input for it is known, i.e. once it can no
+  // longer be rolled back. Peers in sync report the same hashes. Hashing costs a few microseconds per frame,
+  // so it only happens while a callback is set.
+  void set_on_frame_confirmed(std::function<void(uint32_t frame, uint64_t state_hash)> on_frame_confirmed);
+
+  // Hold each outgoing packet back for latency_frames plus up to jitter_frames calls to advance_frame and drop
+  // loss_rate of them, to try rollback over a fast local link. seed makes the losses repeatable.
+  void simulate_network(uint32_t latency_frames, uint32_t jitter_frames, double loss_rate, uint32_t seed);
+
+  uint32_t frame() const { return frame_; }
+  const NetplayStats& stats() const { return stats_; }
+
+private:
+  static constexpr uint32_t SNAPSHOT_COUNT = MAX_ROLLBACK_FRAMES + 1;
+  static constexpr uint32_t INPUT_HISTORY = 64;  // Comfortably more than can be unacknowledged at once
+
+  struct DelayedPacket {
+    uint32_t release_frame;
+    std::vector<uint8_t> data;
+  };
+
+  void receive_inputs();
+  void send_inputs();
+  void flush_delayed_packets();
+  void roll_back();
+  void emulate_frame(bool replay);
+  uint8_t remote_input(uint32_t frame) const;
+  void report_confirmed_frames();
+  void log_stats();
+
+  MainLoop& loop_;
+  UdpSocket socket_;
+  uint64_t session_key_;
+  bool reported_key_mismatch_ = false;
+
+  uint32_t frame_ = 0;            // The next frame to emulate
+  uint32_t local_input_end_ = 0;  // Local input is known for frames before this
+  uint32_t remote_input_end_ = 0;
+  uint32_t peer_ack_ = 0;         // The peer has all local input before this frame
+  uint32_t rollback_frame_ = 0;   // First mispredicted frame, while rollback_pending_
+  bool rollback_pending_ = false;
+  uint32_t confirmed_frame_end_ = 0;
+
+  std::array<uint8_t, INPUT_HISTORY> local_inputs_ = {};
+  std::array<uint8_t, INPUT_HISTORY> remote_inputs_ = {};
+  std::array<uint8_t, INPUT_HISTORY> predicted_inputs_ = {};  // The remote input each frame was emulated with
+  std::array<std::vector<uint8_t>, SNAPSHOT_COUNT> snapshots_;  // The state at the start of each frame
+  std::array<uint64_t, SNAPSHOT_COUNT> frame_hashes_ = {};      // The state at the end of each frame
+  std::function<void(uint32_t, uint64_t)> on_frame_confirmed_;
+
+  uint32_t latency_frames_ = 0;
+  uint32_t jitter_frames_ = 0;
+  double loss_rate_ = 0.0;
+  std::mt19937 network_random_;
+  std::vector<DelayedPacket> delayed_packets_;
+  std::vector<uint8_t> send_buffer_;  // Reused between packets to avoid reallocating
+  std::vector<uint8_t> receive_buffer_;
+
+  NetplayStats stats_;
+  NetplayStats logged_stats_;  // Totals at the last log line
+};
@@ -0,0 +1,229 @@
+#include "fifo_renderer.h"
+#include <algorithm>
+#include "object_line.h"
+#include "palette.h"
+#include "save_state.h"
+#include "tile_row.h"
+
+namespace {
+// Leftmost pixel a fetched object covers. Those hanging off the left edge are all fetched at 0, even at X 0 where
+// nothing of them shows.
+uint8_t object_start(const ObjectAttribute& object) {
+  return object.x < SPRITE_X_OFFSET ? 0 : object.x - SPRITE_X_OFFSET;
+}
+}  // namespace
+
+void FifoRenderer::start_line(const LineSnapshot& line, bool draw) {
+  state_ = {};
+  state_.line = line;
+  state_.draw = draw;
+  state_.start_dots = LINE_START_DOTS;
+  state_.fetch_step = FetchStep::Tile;
+}
+
+uint8_t FifoRenderer::background_fetch_left(const ObjectAttribute& object) {
+  State& s = state_;
+  // Objects hanging off the left edge wait on the fetch of the tile left of the screen instead, which is never
+  // shown. They come along as many dots into it as their X, and once one has waited the rest find it done.
+  if (object.x < SPRITE_X_OFFSET) {
+    const bool waited = s.left_tile_fetched;
+    s.left_tile_fetched = true;
+    return waited ? 0 : std::max(PUSH_TO_LAST_BYTE_DOTS - object.x, 0);
+  }
+
+  // Others wait for the background fetch in progress to reach its last byte, pushing first if the FIFO is empty
+  switch (s.fetch_step) {
+    case FetchStep::Tile:
+      return 2 * FETCH_STEP_DOTS - s.fetch_dot;
+    case FetchStep::DataLow:
+      return FETCH_STEP_DOTS - s.fetch_dot;
+    case FetchStep::DataHigh:
+      return 0;
+    case FetchStep::Push:
+      return s.background_count == 0 ? PUSH_TO_LAST_BYTE_DOTS : 0;
+  }
+  return 0;
+}
+
+void FifoRenderer::hold_for_object(const PPURegisters& registers) {
+  State& s = state_;
+  s.object_dots_total++;
+  s.object_dots--;
+  if (s.object_wait > 0) {
+    s.object_wait--;
+    if (s.line.objects[s.next_object].x >= SPRITE_X_OFFSET) {
+      step_fetcher(registers);
+    }
+  } else if (s.object_dots == 0) {
+    fetch_object(s.line.objects[s.next_object++], registers.get_LCDC());
+  }
+}
+
+bool FifoRenderer::object_starts_here() const {
+  const State& s = state_;
+  return s.next_object < s.line.object_count && object_start(s.line.objects[s.next_object]) == s.x;
+}
+
+void FifoRenderer::step_fetcher(const PPURegisters& registers) {
+  State& s = state_;
+  const uint8_t lcdc = registers.get_LCDC();
+  const uint8_t* vram = memory_.vram().data();
+
+  if (s.fetch_step == FetchStep::Push) {
+    // Tiles only go in once the FIFO has emptied
+    if (s.background_count != 0) {
+      return;
+    }
+    s.background_low = s.data_low;
+    s.background_high = s.data_high;
+    s.background_count = TILE_WIDTH;
+    s.fetch_x++;
+    s.fetch_step = FetchStep::Tile;
+    return;
+  }
+
+  if (++s.fetch_dot < FETCH_STEP_DOTS) {
+    return;
+  }
+  s.fetch_dot = 0;
+
+  switch (s.fetch_step) {
+    case FetchStep::Tile: {
+      uint16_t map_base;
+      uint8_t map_x;
+      uint8_t map_y;
+      if (s.window) {
+        map_base = (lcdc & LCDC_WINDOW_TILE_MAP) ? TILE_MAP_BASE_1 : TILE_MAP_BASE_0;
+        map_x = s.fetch_x * TILE_WIDTH;
+        map_y = s.line.window_line;
+      } else {
+        map_base = (lcdc & LCDC_BG_TILE_MAP) ? TILE_MAP_BASE_1 : TILE_MAP_BASE_0;
+        map_x = registers.get_SCX() + s.fetch_x * TILE_WIDTH;
+        map_y = s.line.scanline + registers.get_SCY();
+      }
+      const uint16_t map_address = map_base + (map_y / TILE_HEIGHT) * TILES_PER_ROW + map_x / TILE_WIDTH;
+      s.tile_index = vram[map_address - VRAM_BASE_ADDRESS];
+      s.tile_y = map_y % TILE_HEIGHT;
+      s.fetch_step = FetchStep::DataLow;
+      break;
+    }
+    case FetchStep::DataLow:
+    case FetchStep::DataHigh: {
+      const uint32_t tile = TileRow::bgwin_tile(s.tile_index, lcdc & LCDC_TILE_DATA);
+      const bool high = s.fetch_step == FetchStep::DataHigh;
+      const uint8_t data = vram[tile * TILE_SIZE_BYTES + s.tile_y * TileRow::BYTES_PER_TILE_ROW + high];
+      (high ? s.data_high : s.data_low) = data;
+      s.fetch_step = high ? FetchStep::Push : FetchStep::DataHigh;
+      break;
+    }
+    case FetchStep::Push:
+      break;
+  }
+}
+
+void FifoRenderer::fetch_object(const ObjectAttribute& object, uint8_t lcdc) {
+  State& s = state_;
+  const bool big_tile_mode = (lcdc & LCDC_SPRITE_SIZE) != 0;
+  uint8_t row = s.line.scanline + SPRITE_Y_OFFSET - object.y;
+  if (object.flip_y()) {
+    row = (big_tile_mode ? SPRITE_HEIGHT_8X16 : SPRITE_HEIGHT_8X8) - row;
+  }
+  uint8_t tile = object.index;
+  if (big_tile_mode) {
+    tile = (tile & 0xFE) | (row >= TILE_HEIGHT);
+  }
+  const uint8_t* data =
+      &memory_.vram()[tile * TILE_SIZE_BYTES + (row % TILE_HEIGHT) * TileRow::BYTES_PER_TILE_ROW];
+
+  const uint8_t attributes =
+      (object.dmg_palette_obp1() ? ObjectLine::OBP1 : 0) | (object.priority() ? ObjectLine::BEHIND_BACKGROUND : 0);
+  // Pixels hanging off the left edge were never going to be shifted out
+  const uint32_t hidden = object.x < SPRITE_X_OFFSET ? SPRITE_X_OFFSET - object.x : 0;
+  for (uint32_t i = hidden; i < TILE_WIDTH; i++) {
+    const uint32_t bit = object.flip_x() ? i : 7 - i;
+    const uint8_t colour = ((data[0] >> bit) & 1) | (((data[1] >> bit) & 1) << 1);
+    uint8_t& pixel = s.objects[i - hidden];
+    // Objects fetched earlier keep the pixels they drew, as they have priority
+    if (colour != 0 && (pixel & ObjectLine::COLOUR_MASK) == 0) {
+      pixel = colour | attributes;
+    }
+  }
+}
+
+void FifoRenderer::step(const PPURegisters& registers) {
+  State& s = state_;
+  if (s.start_dots > 0) {
+    if (--s.start_dots == 0) {
+      s.discard = registers.get_SCX() % TILE_WIDTH;
+    }
+    return;
+  }
+
+  const uint8_t lcdc = registers.get_LCDC();
+  if (s.object_dots > 0) {
+    hold_for_object(registers);
+    return;
+  }
+
+  // The window takes over from the pixel WX - 7, throwing away what the background FIFO holds
+  const uint8_t wx = registers.get_WX();
+  if (!s.window && s.line.window_visible && (lcdc & LCDC_WINDOW_ENABLE) && wx < WINDOW_MAX_X &&
+      (wx >= WINDOW_X_OFFSET ? s.x + WINDOW_X_OFFSET == wx : s.x == 0)) {
+    s.window = true;
+    s.discard = wx >= WINDOW_X_OFFSET ? 0 : WINDOW_X_OFFSET - wx;
+    s.background_count = 0;
+    s.fetch_x = 0;
+    s.fetch_step = FetchStep::Tile;
+    s.fetch_dot = 0;
+  }
+
+  // An object starting here holds the line up, though not before there is a tile to push, as the line's first fetch
+  // goes ahead regardless
+  const bool tile_ready = s.background_count != 0 || s.fetch_step == FetchStep::Push;
+  if ((lcdc & LCDC_SPRITE_ENABLE) && s.discard == 0 && tile_ready && object_starts_here()) {
+    s.object_wait = background_fetch_left(s.line.objects[s.next_object]);
+    s.object_dots = s.object_wait + OBJECT_FETCH_DOTS;
+    hold_for_object(registers);
+    return;
+  }
+
+  step_fetcher(registers);
+  if (s.background_count == 0) {
+    return;
+  }
+
+  const uint8_t index = ((s.background_low >> 7) & 1) | ((s.background_high >> 6) & 2);
+  s.background_low <<= 1;
+  s.background_high <<= 1;
+  s.background_count--;
+  if (s.discard > 0) {
+    s.discard--;
+    return;
+  }
+
+  const uint8_t object = s.objects[0];
+  std::copy(s.objects.begin() + 1, s.objects.end(), s.objects.begin());
+  s.objects.back() = 0;
+
+  // With the background off it shows white and never hides objects
+  const uint8_t background = (lcdc & LCDC_BG_ENABLE) ? index : 0;
+  uint8_t shade = (lcdc & LCDC_BG_ENABLE) ? Palette::shades(registers.get_BGP())[index] : 0;
+  const bool hidden = (object & ObjectLine::BEHIND_BACKGROUND) && background != 0;
+  if ((lcdc & LCDC_SPRITE_ENABLE) && object != 0 && !hidden) {
+    shade = Palette::object_shades(registers.get_OBP0(),
+                                   registers.get_OBP1())[object & ObjectLine::PALETTE_INDEX_MASK];
+  }
+  s.shades[s.x++] = shade;
+
+  if (s.x == SCREEN_WIDTH && s.draw) {
+    screen_.draw_shades(s.line.scanline, s.shades.data());
+  }
+}
+
+void FifoRenderer::serialize(SaveStateSerializer& serializer) const {
+  serializer << state_;
+}
+
+void FifoRenderer::deserialize(SaveStateSerializer& serializer) {
+  serializer >> state_;
+}
@@ -0,0 +1,87 @@
+#pragma once
+
+#include <array>
+#include <cstdint>
+#include <type_traits>
+#include "game_screen.h"
+#include "ppu_constants.h"
+#include "ppu_memory.h"
+#include "ppu_registers.h"
+#include "scanline_renderer.h"
+
+class SaveStateSerializer;
+
+// Draws scanlines the way the hardware does, a dot at a time. A fetcher reads the tile map and tile data into the
+// background FIFO, which shifts out a pixel a dot; objects are fetched into a FIFO of their own as the line reaches
+// them, stalling it, and the window restarts the fetcher where it begins. Registers are read on the dot that uses
+// them, so writes made during mode 3 land exactly, and the line takes as long as the fetches do, which is what sets
+// the length of mode 3. Several times slower than ScanlineRenderer, for accuracy over speed.
+class FifoRenderer {
+public:
+  // The PPU steps this renderer through mode 3 and ends mode 3 when it finishes the line
+  static constexpr bool DOT_TIMED = true;
+
+  FifoRenderer(PPUMemory& memory, GameScreen& screen) : memory_(memory), screen_(screen) {}
+
+  // Starts mode 3 of a line. Only what OAM search settled is taken from line: its objects, the scanline and the
+  // window line counter. Registers are read as the line goes. The line is only put on screen if draw is set.
+  void start_line(const LineSnapshot& line, bool draw);
+
+  // One dot of mode 3 with registers as they are now. The line goes on screen with its last pixel.
+  void step(const PPURegisters& registers);
+  bool line_done() const { return state_.x == SCREEN_WIDTH; }
+
+  // Dots objects have held the line up for so far, waiting for background fetches and fetching themselves
+  uint16_t object_dots() const { return state_.object_dots_total; }
+
+  // Everything carried between dots, so states saved during mode 3 resume the line exactly
+  void serialize(SaveStateSerializer& serializer) const;
+  void deserialize(SaveStateSerializer& serializer);
+
+private:
+  enum class FetchStep : uint8_t { Tile, DataLow, DataHigh, Push };
+
+  // The first fetch of every line is thrown away, which is most of mode 3's 12 dots before the first pixel
+  static constexpr uint8_t LINE_START_DOTS = 6;
+  static constexpr uint8_t FETCH_STEP_DOTS = 2;
+  static constexpr uint8_t OBJECT_FETCH_DOTS = 6;
+  static constexpr int32_t PUSH_TO_LAST_BYTE_DOTS = 5;  // From pushing a tile to reading the next one's last byte
+
+  struct State {
+    LineSnapshot line;
+    bool draw;
+    uint8_t x;              // Next pixel to go out
+    uint8_t start_dots;     // Left of LINE_START_DOTS
+    uint8_t discard;        // Pixels still to drop for SCX's fine scroll, or a window left of the screen edge
+    bool window;            // The fetcher has switched to the window for the rest of the line
+    FetchStep fetch_step;
+    uint8_t fetch_dot;      // Dots spent in fetch_step so far
+    uint8_t fetch_x;        // Tile column of the next fetch, counted from SCX or the window's left edge
+    uint8_t tile_index;
+    uint8_t tile_y;         // Row within the tile being fetched
+    uint8_t data_low;
+    uint8_t data_high;
+    uint8_t background_low; // Background FIFO as two bit planes, leftmost pixel in bit 7
+    uint8_t background_high;
+    uint8_t background_count;
+    std::array<uint8_t, TILE_WIDTH> objects;  // Object FIFO, a byte per pixel as ObjectLine draws them
+    uint8_t next_object;    // Next of line.objects to fetch, in X order
+    uint8_t object_dots;    // Left of the hold up for an object in progress, 0 if none
+    uint8_t object_wait;    // Of those, dots still waiting on the background fetch
+    bool left_tile_fetched; // An object hanging off the left edge has waited for the tile left of the screen
+    uint8_t object_dots_total;
+    std::array<uint8_t, SCREEN_WIDTH> shades;
+  };
+  // Saved as raw bytes and hashed with the rest of the machine state, so there must be no padding in it
+  static_assert(std::has_unique_object_representations_v<State>);
+
+  void step_fetcher(const PPURegisters& registers);
+  void fetch_object(const ObjectAttribute& object, uint8_t lcdc);
+  bool object_starts_here() const;
+  uint8_t background_fetch_left(const ObjectAttribute& object);
+  void hold_for_object(const PPURegisters& registers);
+
+  PPUMemory& memory_;
+  GameScreen& screen_;
+  State state_ = {};
+};
@@ -1,13 +1,101 @@
 #include "game_screen.h"
+#include <bit>
+#include "palette.h"
 #include "ppu_constants.h"
-#include "rgb.h"
-
-void GameScreen::clear(const RGBValue& color) {
-  const uint32_t packed = color.argb;
-  for (uint32_t y = 0; y < SCREEN_HEIGHT; ++y) {
-    for (uint32_t x = 0; x < SCREEN_WIDTH; ++x) {
-      background_pixels_[y][x] = color;
-      pixel_buffer_[(y * SCREEN_WIDTH) + x] = packed;
+#include "tile_row.h"
+
+const uint32_t* GameScreen::pixel_data() {
+  if (!stale_.empty()) {
+    const uint32_t offset = stale_.first * SCREEN_WIDTH;
+    TileRow::apply_palette(&shade_buffer_[offset], GameBoyColors::SHADES, &pixel_buffer_[offset],
+                           (stale_.end - stale_.first) * SCREEN_WIDTH);
+    stale_ = {SCREEN_HEIGHT, 0};
+  }
+  return pixel_buffer_.data();
+}
+
+void GameScreen::convert_lines(const uint8_t* shades, size_t shade_pitch, LineRange lines, uint32_t* pixels,
+                               size_t pitch) {
+  for (uint32_t y = lines.first; y < lines.end; y++) {
+    TileRow::apply_palette(shades + y * shade_pitch, GameBoyColors::SHADES, pixels, SCREEN_WIDTH);
+    pixels = reinterpret_cast<uint32_t*>(reinterpret_cast<uint8_t*>(pixels) + pitch);
+  }
+}
+
+GameScreen::LineRange GameScreen::take_changed_lines() {
+  auto changed = [this](uint32_t y) {
+    return memcmp(&shade_buffer_[y * SCREEN_WIDTH], &taken_shades_[y * SCREEN_WIDTH], SCREEN_WIDTH) != 0;
+  };
+  LineRange lines = drawn_;
+  while (lines.first < lines.end && !changed(lines.first)) {
+    lines.first++;
+  }
+  while (lines.end > lines.first && !changed(lines.end - 1)) {
+    lines.end--;
+  }
+  if (lines.empty()) {
+    lines = {};
+  } else {
+    const uint32_t offset = lines.first * SCREEN_WIDTH;
+    memcpy(&taken_shades_[offset], &shade_buffer_[offset], (lines.end - lines.first) * SCREEN_WIDTH);
+  }
+  drawn_ = {SCREEN_HEIGHT, 0};
+  return lines;
+}
+
+void GameScreen::restore_changed_lines(LineRange lines) {
+  if (lines.empty()) {
+    return;
+  }
+  const uint32_t offset = lines.first * SCREEN_WIDTH;
+  memset(&taken_shades_[offset], NO_SHADE, (lines.end - lines.first) * SCREEN_WIDTH);
+  drawn_.first = std::min(drawn_.first, lines.first);
+  drawn_.end = std::max(drawn_.end, lines.end);
+}
+
+void GameScreen::draw_object_span(uint32_t y, uint32_t x, uint32_t count, const uint8_t* objects,
+                                  const std::array<uint8_t, 8>& shades) {
+  constexpr uint64_t LOW_BITS = 0x0101010101010101ull;
+  constexpr int OBP1_SHIFT = std::countr_zero(ObjectLine::OBP1);
+  constexpr int BEHIND_BACKGROUND_SHIFT = std::countr_zero(ObjectLine::BEHIND_BACKGROUND);
+  const std::array<uint8_t, 4> obp0 = {shades[0], shades[1], shades[2], shades[3]};
+  const std::array<uint8_t, 4> obp1 = {shades[4], shades[5], shades[6], shades[7]};
+  uint8_t* pixels = &shade_buffer_[y * SCREEN_WIDTH];
+  const uint8_t* background = background_indices_[y].data();
+  // Eight pixels at a time, as most of a line usually has no objects on it
+  const uint32_t end = x + count;
+  for (; x + TILE_WIDTH <= end; x += TILE_WIDTH) {
+    uint64_t line;
+    memcpy(&line, objects + x, sizeof(line));
+    if (line == 0) {
+      continue;
     }
+    uint64_t background_line;
+    memcpy(&background_line, background + x, sizeof(background_line));
+    const uint64_t opaque = (line | (line >> 1)) & LOW_BITS;
+    const uint64_t hidden = (line >> BEHIND_BACKGROUND_SHIFT) & (background_line | (background_line >> 1)) & LOW_BITS;
+    const uint64_t shown = (opaque & ~hidden) * 0xFF;
+    const uint64_t uses_obp1 = ((line >> OBP1_SHIFT) & LOW_BITS) * 0xFF;
+    const uint64_t object_shades =
+        (TileRow::shade(line, obp0) & ~uses_obp1) | (TileRow::shade(line, obp1) & uses_obp1);
+
+    uint64_t out;
+    memcpy(&out, pixels + x, sizeof(out));
+    out = (out & ~shown) | (object_shades & shown);
+    memcpy(pixels + x, &out, sizeof(out));
+  }
+  for (; x < end; x++) {
+    const uint8_t object = objects[x];
+    const bool hidden = (object & ObjectLine::BEHIND_BACKGROUND) && background[x] != 0;
+    pixels[x] = object != 0 && !hidden ? shades[object & ObjectLine::PALETTE_INDEX_MASK] : pixels[x];
+  }
+  mark_drawn(y);
+}
+
+void GameScreen::clear(uint8_t shade) {
+  for (auto& row : background_indices_) {
+    row.fill(0);
   }
-}
\ No newline at end of file
+  shade_buffer_.fill(shade);
+  stale_ = drawn_ = {0, SCREEN_HEIGHT};
+}
@@ -1,35 +1,91 @@
 #pragma once
 
 #include <inttypes.h>
+#include <algorithm>
 #include <array>
+#include <cstring>
+#include "object_line.h"
 #include "ppu_constants.h"
-#include "rgb.h"
+#include "tile_row.h"
 
+// The frame as the PPU draws it: one shade per pixel, from 0 (white) to 3 (black), with the palettes already
+// applied line by line. It is only turned into ARGB when someone asks for pixel_data, once per frame drawn.
 class GameScreen {
 public:
-  [[gnu::always_inline]] inline void draw_background_pixel(uint32_t x, uint32_t y, const RGBValue& color) {
-    background_pixels_[y][x] = color;
-    pixel_buffer_[(y * SCREEN_WIDTH) + x] = color.argb;
+  // Scanlines first up to end
+  struct LineRange {
+    uint32_t first = 0;
+    uint32_t end = 0;
+    bool empty() const { return first >= end; }
+  };
+
+  GameScreen() { taken_shades_.fill(NO_SHADE); }
+
+  // A whole scanline of background colour indices, shown through shades
+  void draw_background_line(uint32_t y, const uint8_t* indices, const std::array<uint8_t, 4>& shades) {
+    draw_background_span(y, 0, SCREEN_WIDTH, indices, shades);
   }
 
-  [[gnu::always_inline]] inline void draw_object_pixel(uint32_t x, uint32_t y, const RGBAValue& color) {
-    if (!color.active)
-      return;
+  // Background colour indices for count pixels of scanline y from x
+  void draw_background_span(uint32_t y, uint32_t x, uint32_t count, const uint8_t* indices,
+                            const std::array<uint8_t, 4>& shades) {
+    memcpy(&background_indices_[y][x], indices, count);
+    TileRow::apply_shades(indices, shades, &shade_buffer_[y * SCREEN_WIDTH + x], count);
+    mark_drawn(y);
+  }
 
-    const auto& background = background_pixels_[y][x];
-    if (color.priority && background.index != 0)
-      return;
+  // A whole scanline already composited, for renderers that mix objects in themselves
+  void draw_shades(uint32_t y, const uint8_t* shades) {
+    memcpy(&shade_buffer_[y * SCREEN_WIDTH], shades, SCREEN_WIDTH);
+    mark_drawn(y);
+  }
 
-    pixel_buffer_[(y * SCREEN_WIDTH) + x] = color.argb;
+  // A scanline of object pixels composited over the background drawn on it, shades as Palette::object_shades
+  void draw_object_line(uint32_t y, const uint8_t* objects, const std::array<uint8_t, 8>& shades) {
+    draw_object_span(y, 0, SCREEN_WIDTH, objects, shades);
   }
 
-  [[gnu::always_inline]] const uint32_t* pixel_data() const { return pixel_buffer_.data(); }
+  // Object pixels composited over count pixels of scanline y from x. objects is the whole line, from pixel 0.
+  void draw_object_span(uint32_t y, uint32_t x, uint32_t count, const uint8_t* objects,
+                        const std::array<uint8_t, 8>& shades);
+
+  [[gnu::always_inline]] const uint8_t* shade_data() const { return shade_buffer_.data(); }
+  [[gnu::always_inline]] constexpr static size_t shade_pitch() { return SCREEN_WIDTH; }
 
+  // The frame as ARGB, converted from the shades if anything was drawn since last asked
+  const uint32_t* pixel_data();
+  // Scanlines of the frame converted to ARGB straight into someone else's buffer, pixels pointing at the first of
+  // them and pitch in bytes
+  void convert_lines(LineRange lines, uint32_t* pixels, size_t pitch) const {
+    convert_lines(shade_buffer_.data(), shade_pitch(), lines, pixels, pitch);
+  }
+  // The same for a copy of the shades kept elsewhere, shade_pitch bytes apart row to row
+  static void convert_lines(const uint8_t* shades, size_t shade_pitch, LineRange lines, uint32_t* pixels,
+                            size_t pitch);
   [[gnu::always_inline]] constexpr static size_t pitch() { return SCREEN_WIDTH * sizeof(uint32_t); }
 
-  void clear(const RGBValue& color);
+  void clear(uint8_t shade);
+
+  // Scanlines that differ from the frame as it was at the last call, found by comparing only those drawn since.
+  // All of them on the first call.
+  LineRange take_changed_lines();
+  // Hands back lines from take_changed_lines that never got shown, so the next call reports them again
+  void restore_changed_lines(LineRange lines);
 
 private:
-  std::array<std::array<RGBValue, SCREEN_WIDTH>, SCREEN_HEIGHT> background_pixels_;
+  static constexpr uint8_t NO_SHADE = 0xFF;
+
+  void mark_drawn(uint32_t y) {
+    stale_.first = std::min(stale_.first, y);
+    stale_.end = std::max(stale_.end, y + 1);
+    drawn_.first = std::min(drawn_.first, y);
+    drawn_.end = std::max(drawn_.end, y + 1);
+  }
+
+  std::array<std::array<uint8_t, SCREEN_WIDTH>, SCREEN_HEIGHT> background_indices_{};
+  std::array<uint8_t, SCREEN_WIDTH * SCREEN_HEIGHT> shade_buffer_{};
   std::array<uint32_t, SCREEN_WIDTH * SCREEN_HEIGHT> pixel_buffer_{};
-};
\ No newline at end of file
+  std::array<uint8_t, SCREEN_WIDTH * SCREEN_HEIGHT> taken_shades_{};  // As at the last take_changed_lines
+  LineRange stale_ = {0, SCREEN_HEIGHT};                               // Drawn since the last pixel_data
+  LineRange drawn_ = {0, SCREEN_HEIGHT};                               // Drawn since the last take_changed_lines
+};
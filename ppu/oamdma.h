@@ -4,16 +4,15 @@
 #include <functional>
 #include <iostream>
 #include "ppu_constants.h"
-#include "save_state.h"
 
+// Plain data so a transfer in flight can be saved and restored as raw bytes; the memory it reads from and the
+// OAM it writes to are passed in on every tick.
 class OAMDMA {
 public:
   OAMDMA() = default;
-  OAMDMA(std::function<const uint8_t*(uint16_t)> read_memory, std::array<unsigned char, OAM_SIZE>& oam,
-         uint16_t source_address)
-      : read_memory_(read_memory), oam_(&oam), source_address_(source_address) {}
+  explicit OAMDMA(uint16_t source_address) : source_address_(source_address) {}
 
-  bool tick() {
+  bool tick(const std::function<const uint8_t*(uint16_t)>& read_memory, std::array<unsigned char, OAM_SIZE>& oam) {
     if (wait_) {
       wait_--;
       return false;
@@ -25,39 +24,19 @@ public:
     uint16_t address = source_address_ + index_;
 
     if (address >= OAM_BASE_ADDRESS && address <= OAM_END_ADDRESS) {
-      (*oam_)[index_] = (*oam_)[address - OAM_BASE_ADDRESS];
+      oam[index_] = oam[address - OAM_BASE_ADDRESS];
     } else {
-      (*oam_)[index_] = *read_memory_(address);
+      oam[index_] = *read_memory(address);
     }
 
     index_++;
-    return index_ == oam_->size();
+    return index_ == oam.size();
   }
 
   bool running() const { return wait_ == 0; }
 
-  void serialize(SaveStateSerializer& serializer) const {
-    serializer << source_address_;
-    serializer << index_;
-    serializer << wait_;
-  }
-
-  void deserialize(SaveStateSerializer& serializer) {
-    serializer >> source_address_;
-    serializer >> index_;
-    serializer >> wait_;
-  }
-
-  void restore_pointers(std::function<const uint8_t*(uint16_t)> read_memory,
-                        std::array<unsigned char, OAM_SIZE>& oam) {
-    read_memory_ = read_memory;
-    oam_ = &oam;
-  }
-
 private:
-  std::function<const uint8_t*(uint16_t)> read_memory_;
-  std::array<unsigned char, OAM_SIZE>* oam_;
-  uint16_t source_address_;
+  uint16_t source_address_ = 0;
   uint16_t index_ = 0;
   int wait_ = OAMDMA_WAIT_CYCLES;
 };
\ No newline at end of file
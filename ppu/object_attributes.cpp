@@ -1,9 +1,13 @@
 #include "object_attributes.h"
 #include <algorithm>
+#include <numeric>
 #include "ppu_constants.h"
+#include "ppu_memory.h"
 
-ObjectAttributes::ObjectAttributes(std::array<unsigned char, OAM_SIZE>& oam) {
-  attributes_ = reinterpret_cast<ObjectAttribute*>(&oam);
+ObjectAttributes::ObjectAttributes(PPUMemory& ppu_memory) : ppu_memory_(ppu_memory) {
+  attributes_ = reinterpret_cast<ObjectAttribute*>(ppu_memory.oam().data());
+  offscreen_.objects.fill(nullptr);
+  offscreen_.penalty_scx = NO_PENALTY_SCX;
 }
 
 ObjectAttribute* ObjectAttributes::begin() {
@@ -14,44 +18,80 @@ ObjectAttribute* ObjectAttributes::end() {
   return attributes_ + TOTAL_SPRITES;
 }
 
-std::array<ObjectAttribute*, 10>& ObjectAttributes::get_objects_for_scanline(int16_t scanline,
-                                                                             bool big_tile_mode) {
-  current_objects.fill(nullptr);
+const std::array<ObjectAttribute*, MAX_SPRITES_PER_SCANLINE>& ObjectAttributes::get_objects_for_scanline(
+    int16_t scanline, bool big_tile_mode) {
+  if (!built_ || built_oam_generation_ != ppu_memory_.oam_generation() || built_big_tile_mode_ != big_tile_mode) {
+    rebuild(big_tile_mode);
+  }
+  if (scanline < 0 || scanline >= static_cast<int16_t>(SCREEN_HEIGHT)) {
+    return offscreen_.objects;
+  }
+  return scanlines_[scanline].objects;
+}
+
+uint8_t ObjectAttributes::get_mode_3_penalty(int16_t scanline, uint8_t scx) {
+  Scanline& line = scanline < 0 || scanline >= static_cast<int16_t>(SCREEN_HEIGHT) ? offscreen_ : scanlines_[scanline];
+  scx &= 7;
+  if (line.penalty_scx != scx) {
+    line.penalty = compute_mode_3_penalty(line, scx);
+    line.penalty_scx = scx;
+  }
+  return line.penalty;
+}
+
+void ObjectAttributes::rebuild(bool big_tile_mode) {
+  for (Scanline& line : scanlines_) {
+    line.count = 0;
+  }
 
-  uint8_t next_object = 0;
+  // Objects cover 8 or 16 scanlines from Y - 16, and each scanline takes the first 10 it finds in OAM
+  const int16_t height = big_tile_mode ? SPRITE_HEIGHT_8X16 + 1 : SPRITE_HEIGHT_8X8 + 1;
   for (uint32_t i = 0; i < TOTAL_SPRITES; ++i) {
-    if (object_interacts_with_scanline(attributes_[i], scanline, big_tile_mode)) {
-      current_objects[next_object] = &attributes_[i];
-      next_object++;
+    const int16_t top = attributes_[i].y - SPRITE_Y_OFFSET;
+    const int16_t first = std::max<int16_t>(top, 0);
+    const int16_t last = std::min<int16_t>(top + height, SCREEN_HEIGHT);
+    for (int16_t scanline = first; scanline < last; scanline++) {
+      Scanline& line = scanlines_[scanline];
+      if (line.count < MAX_SPRITES_PER_SCANLINE) {
+        line.objects[line.count++] = &attributes_[i];
+      }
     }
-
-    if (next_object == MAX_SPRITES_PER_SCANLINE)
-      break;
   }
 
-  sort_by_x(current_objects);
+  for (Scanline& line : scanlines_) {
+    std::fill(line.objects.begin() + line.count, line.objects.end(), nullptr);
+    std::stable_sort(line.objects.begin(), line.objects.begin() + line.count,
+                     [](const ObjectAttribute* a, const ObjectAttribute* b) { return a->x < b->x; });
+    line.penalty_scx = NO_PENALTY_SCX;
+  }
 
-  return current_objects;
+  built_oam_generation_ = ppu_memory_.oam_generation();
+  built_big_tile_mode_ = big_tile_mode;
+  built_ = true;
 }
 
-bool ObjectAttributes::object_interacts_with_scanline(ObjectAttribute& object, int16_t scanline,
-                                                      bool big_tile_mode) {
-  int16_t y_top = object.y - SPRITE_Y_OFFSET;
-  constexpr int16_t Y_BOTTOM_OFFSET_8X8 = 9;
-  constexpr int16_t Y_BOTTOM_OFFSET_8X16 = 1;
-  int16_t y_bottom = object.y - (big_tile_mode ? Y_BOTTOM_OFFSET_8X16 : Y_BOTTOM_OFFSET_8X8);
+uint8_t ObjectAttributes::compute_mode_3_penalty(const Scanline& line, uint8_t scx) {
+  std::array<int16_t, 21> penalty_map = {0};
 
-  if (scanline > y_bottom || scanline < y_top)
-    return false;
-  return true;
-}
+  uint8_t total = scx;
+
+  for (uint8_t i = 0; i < line.count; i++) {
+    uint8_t object_x = line.objects[i]->x;
+
+    if (object_x >= 168)
+      continue;
+
+    if (object_x == 0) {
+      object_x += scx;
+    }
 
-void ObjectAttributes::sort_by_x(std::array<ObjectAttribute*, 10>& objects) {
-  std::stable_sort(objects.begin(), objects.end(), [](ObjectAttribute* a, ObjectAttribute* b) {
-    if (a == nullptr)
-      return false;  // nullptr goes to end
-    if (b == nullptr)
-      return true;  // non-nullptr comes before nullptr
-    return a->x < b->x;
-  });
-}
\ No newline at end of file
+    uint8_t bucket = object_x >> 3;
+
+    penalty_map[bucket] = std::max(penalty_map[bucket], static_cast<int16_t>(5 - (object_x & 7)));
+    total += 6;
+  }
+
+  total +=
+      std::accumulate(penalty_map.begin(), penalty_map.end(), 0, [](int16_t a, int16_t b) { return a + b; });
+  return (total >> 2) * 4;
+}
@@ -4,6 +4,8 @@
 #include <array>
 #include "ppu_constants.h"
 
+class PPUMemory;
+
 namespace {
 constexpr uint8_t FLAG_PRIORITY_BIT = 7;
 constexpr uint8_t FLAG_FLIP_Y_BIT = 6;
@@ -24,19 +26,41 @@ public:
   bool dmg_palette_obp1() const { return (flags >> FLAG_PALETTE_BIT) & 1; }
 };
 
+// Objects bucketed by the scanlines they cover. The buckets are rebuilt in one pass over OAM when they are next
+// used after OAM or the object size has changed, so most frames build them once and every scanline after that
+// is a lookup.
 class ObjectAttributes {
 public:
-  ObjectAttributes(std::array<unsigned char, OAM_SIZE>& oam);
+  ObjectAttributes(PPUMemory& ppu_memory);
   ObjectAttribute* begin();
   ObjectAttribute* end();
 
-  std::array<ObjectAttribute*, MAX_SPRITES_PER_SCANLINE>& get_objects_for_scanline(int16_t scanline,
-                                                                                   bool big_tile_mode);
+  // The first 10 objects in OAM on scanline, in priority order (by X, then OAM position), nullptr after the last
+  const std::array<ObjectAttribute*, MAX_SPRITES_PER_SCANLINE>& get_objects_for_scanline(int16_t scanline,
+                                                                                         bool big_tile_mode);
+
+  // T-cycles the objects on scanline add to mode 3, from the last get_objects_for_scanline for it
+  uint8_t get_mode_3_penalty(int16_t scanline, uint8_t scx);
 
 private:
-  bool object_interacts_with_scanline(ObjectAttribute& object, int16_t scanline, bool big_tile_mode);
-  void sort_by_x(std::array<ObjectAttribute*, MAX_SPRITES_PER_SCANLINE>& objects);
+  static constexpr uint8_t NO_PENALTY_SCX = 0xFF;
+
+  struct Scanline {
+    std::array<ObjectAttribute*, MAX_SPRITES_PER_SCANLINE> objects;
+    uint8_t count;
+    uint8_t penalty_scx;  // SCX & 7 that penalty is for, NO_PENALTY_SCX before it is first worked out
+    uint8_t penalty;
+  };
+
+  void rebuild(bool big_tile_mode);
+  static uint8_t compute_mode_3_penalty(const Scanline& line, uint8_t scx);
+
   ObjectAttribute* attributes_;
+  const PPUMemory& ppu_memory_;
 
-  std::array<ObjectAttribute*, MAX_SPRITES_PER_SCANLINE> current_objects{nullptr};
-};
\ No newline at end of file
+  std::array<Scanline, SCREEN_HEIGHT> scanlines_;
+  Scanline offscreen_ = {};  // No objects, for scanlines past the bottom
+  uint32_t built_oam_generation_ = 0;
+  bool built_big_tile_mode_ = false;
+  bool built_ = false;
+};
@@ -0,0 +1,40 @@
+#include "object_line.h"
+
+namespace ObjectLine {
+
+void draw_objects(Buffer& line, const std::array<ObjectAttribute*, MAX_SPRITES_PER_SCANLINE>& objects,
+                  uint8_t scanline, bool big_tile_mode, const TileRow::DecodedTiles& tiles,
+                  const TileRow::DecodedTiles& flipped_tiles) {
+  // Objects earlier in the list win where they overlap, so draw them last
+  for (int32_t slot = MAX_SPRITES_PER_SCANLINE - 1; slot >= 0; slot--) {
+    const ObjectAttribute* object = objects[slot];
+    if (object == nullptr || object->x >= SCREEN_WIDTH + SPRITE_X_OFFSET)
+      continue;
+
+    uint32_t pixel_y = (int16_t)scanline - (object->y - SPRITE_Y_OFFSET);
+    if (object->flip_y()) {
+      uint8_t sprite_height = big_tile_mode ? SPRITE_HEIGHT_8X16 : SPRITE_HEIGHT_8X8;
+      pixel_y = sprite_height - pixel_y;
+    }
+
+    uint8_t tile_index = object->index;
+    if (big_tile_mode) {
+      // In 8x16 mode, bit 0 is ignored and two consecutive tiles are used
+      constexpr uint8_t TILE_INDEX_BIT_0_MASK = 0xFE;
+      constexpr uint8_t TILE_INDEX_BIT_0_SET = 0x01;
+      tile_index &= TILE_INDEX_BIT_0_MASK;  // Clear bit 0
+      if (pixel_y >= TILE_HEIGHT) {
+        tile_index |= TILE_INDEX_BIT_0_SET;  // Use second tile for bottom half
+        pixel_y -= TILE_HEIGHT;
+      }
+    }
+
+    const auto& object_tiles = object->flip_x() ? flipped_tiles : tiles;
+    const uint8_t attributes = (object->dmg_palette_obp1() ? OBP1 : 0) |
+                               (object->priority() ? BEHIND_BACKGROUND : 0) | slot << OWNER_SHIFT;
+    // The object's left edge is at x - 8, which is x in the buffer
+    draw_span(&line[object->x], object_tiles[tile_index][pixel_y], attributes);
+  }
+}
+
+}  // namespace ObjectLine
@@ -0,0 +1,39 @@
+#pragma once
+
+#include <array>
+#include <cstdint>
+#include <cstring>
+#include "object_attributes.h"
+#include "ppu_constants.h"
+#include "tile_row.h"
+
+// A scanline of object pixels, one byte each, before they are composited over the background. 0 means no object
+// pixel, as colour 0 is transparent and anything drawn has a non-zero colour.
+
+namespace ObjectLine {
+constexpr uint8_t COLOUR_MASK = 0x03;
+constexpr uint8_t OBP1 = 0x04;               // Shown through OBP1 rather than OBP0
+constexpr uint8_t BEHIND_BACKGROUND = 0x08;  // Hidden by background colours 1-3
+constexpr uint8_t OWNER_SHIFT = 4;           // Which of the scanline's objects drew the pixel
+constexpr uint8_t PALETTE_INDEX_MASK = COLOUR_MASK | OBP1;
+
+// Room for objects hanging off either edge of the screen, so spans never need clipping
+constexpr uint32_t SLACK = TILE_WIDTH;
+using Buffer = std::array<uint8_t, SCREEN_WIDTH + 2 * SLACK>;
+
+// Draws the 8 pixels of an object's tile row at out, as TileRow::decode packs them, over whatever is there.
+// Transparent pixels leave what is there, so objects drawn later win.
+[[gnu::always_inline]] inline void draw_span(uint8_t* out, uint64_t colours, uint8_t attributes) {
+  constexpr uint64_t LOW_BITS = 0x0101010101010101ull;
+  const uint64_t opaque = ((colours | (colours >> 1)) & LOW_BITS) * 0xFF;
+  uint64_t line;
+  memcpy(&line, out, sizeof(line));
+  line = (line & ~opaque) | ((colours | attributes * LOW_BITS) & opaque);
+  memcpy(out, &line, sizeof(line));
+}
+
+// Draws a scanline's objects into line, given in priority order as ObjectAttributes selects them for it
+void draw_objects(Buffer& line, const std::array<ObjectAttribute*, MAX_SPRITES_PER_SCANLINE>& objects,
+                  uint8_t scanline, bool big_tile_mode, const TileRow::DecodedTiles& tiles,
+                  const TileRow::DecodedTiles& flipped_tiles);
+}  // namespace ObjectLine
@@ -1,12 +1,16 @@
 #pragma once
 
 #include <inttypes.h>
+#include "fifo_renderer.h"
 #include "game_screen.h"
 #include "object_attributes.h"
-#include "palette.h"
+#include <memory>
 #include "ppu_bridge.h"
 #include "ppu_memory.h"
+#include "ppu_policy.h"
 #include "ppu_registers.h"
+#include "render_worker.h"
+#include "scanline_renderer.h"
 
 class SaveStateSerializer;
 
@@ -17,9 +21,13 @@ enum class PPUMode : uint8_t {
   PixelTransfer = 3  // Mode 3
 };
 
-class PPU {
+//Renderer is the policy drawing the pixels: ScanlineRenderer draws a whole line as mode 3 ends, with mode 3's length
+//worked out from penalties, while a renderer with DOT_TIMED set, such as FifoRenderer, is stepped through mode 3 a
+//dot at a time and decides when it ends. ppu_policy.h picks the one the emulator is built with.
+template <typename Renderer>
+class BasicPPU {
 public:
-  PPU(PPUBridge ppu_bridge, bool boot_rom_active);
+  BasicPPU(PPUBridge ppu_bridge, bool boot_rom_active);
 
   //Call this once per m-cycle
   void tick();
@@ -40,6 +48,11 @@ public:
   void write_vram(uint16_t addr, uint8_t value) {
     if (current_mode_ != PPUMode::PixelTransfer) {
       ppu_memory_.write_vram(addr, value);
+      if (render_worker_ && skip_rendering_) {
+        render_worker_vram_stale_ = true;
+      } else if (render_worker_) {
+        render_worker_->write_vram(addr, value);
+      }
     }
   }
 
@@ -55,23 +68,35 @@ public:
   //Write PPU registers to here - Everything from FF40 -> FF6C
   void write_ppu_register(uint16_t addr, uint8_t value);
 
-  //Saving and loading PPU state.
+  //Skip drawing pixels while keeping everything rendering does to timing, for frames that won't be shown.
+  //The screen keeps its last drawn contents meanwhile.
+  void set_skip_rendering(bool skip) { skip_rendering_ = skip; }
+
+  //Draw scanlines on a worker thread, while this one only works out their timing. Frames come out the same either
+  //way; each is waited for at VBlank before it is handed to blit_screen. Ignored by dot timed renderers.
+  void set_render_thread(bool enabled);
+
+  PPUMemory& memory() { return ppu_memory_; }
+  const PPUMemory& memory() const { return ppu_memory_; }
+
+  //Saving and loading PPU state. PPU memory is saved separately.
+  static constexpr uint32_t SAVE_STATE_VERSION = 2;
   void serialize(SaveStateSerializer& serializer) const;
   void deserialize(SaveStateSerializer& serializer);
 
 private:
+  static bool stat_should_fire(uint8_t current_stat);
   void stat_write(uint16_t address, uint8_t value);
   void check_mode_change();
 
-  uint8_t get_object_mode_3_penalty(std::array<ObjectAttribute*, 10>& objects, uint8_t scx);
   void render_scanline(uint8_t scanline);
-  void render_background_scanline(uint8_t scanline);
-  void render_object_scanline(uint8_t scanline);
+  LineSnapshot capture_line(uint8_t scanline, const std::array<ObjectAttribute*, 10>* objects,
+                            bool window_visible) const;
+  void draw_pending_line();
+  void log_register_change(uint16_t addr, uint8_t value);
+  bool start_window_line(uint8_t scanline);
+  const std::array<ObjectAttribute*, 10>& scan_objects(uint8_t scanline);
 
-  uint16_t get_bg_tile_map_address(uint32_t x, uint32_t y);
-  uint16_t get_win_tile_map_address(uint32_t x, uint32_t y);
-  uint16_t get_bgwin_tile_address(uint16_t tile_index);
-  uint16_t get_obj_tile_address(uint16_t tile_index);
 
   void set_mode(PPUMode mode);
   void set_LY(bool force = false);
@@ -84,6 +109,7 @@ private:
   uint16_t elapsed_t_cycles_ = 0;
   uint8_t scanline_ = 0;
   uint8_t mode_3_penalty_ = 0;
+  uint16_t mode_3_dots_ = 0;  // Dots into mode 3, for dot timed renderers
   uint16_t window_scanline_ = 0;
 
   // Enable and status flags
@@ -97,10 +123,21 @@ private:
   PPUMemory ppu_memory_;
   GameScreen game_screen_;
   ObjectAttributes oam_attributes_;
-  Palette palette_;
+  Renderer renderer_;
 
   // Bridge
   PPUBridge ppu_bridge_;
 
   bool fire_hblank_next_tick_ = false;
-};
\ No newline at end of file
+  bool skip_rendering_ = false;
+
+  // The line in mode 3, drawn as it ends so register writes made meanwhile can be applied from where they landed
+  LineSnapshot pending_line_ = {};
+  bool line_pending_ = false;
+
+  // Set when VRAM may have changed without the worker hearing of it, so it gets a fresh copy before the next line
+  bool render_worker_vram_stale_ = false;
+  std::unique_ptr<RenderWorker> render_worker_;  // Last, so it stops before the screen it draws on goes away
+};
+
+#include "ppu.inc"
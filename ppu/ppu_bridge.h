@@ -4,10 +4,12 @@
 #include <cstdint>
 #include <functional>
 
+class GameScreen;
+
 struct PPUBridge {
   std::function<void()> trigger_vblank_interrupt;
   std::function<void()> trigger_lcd_stat_interrupt;
-  std::function<void(const uint32_t* pixels, size_t pitch)> blit_screen;
+  std::function<void(GameScreen& screen)> blit_screen;  // Each finished frame, still in shades
   std::function<bool()> is_halted;  //Needed for correct handling of delaying interrupts in halted mode.
   std::function<const uint8_t*(uint16_t)> read_memory;  //Needed for OAM DMA transfers.
 };
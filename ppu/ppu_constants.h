@@ -30,6 +30,8 @@ constexpr uint8_t TILE_WIDTH = 8;
 constexpr uint8_t TILE_HEIGHT = 8;
 constexpr uint8_t TILE_SIZE_BYTES = 16;  // Each tile is 16 bytes (8x8 pixels, 2 bytes per row)
 constexpr uint8_t TILES_PER_ROW = 32;    // 32 tiles per row in tile map
+constexpr uint16_t TILE_COUNT = 384;     // Tiles in tile data, 0x8000-0x97FF
+constexpr uint16_t TILE_DATA_SIZE = TILE_COUNT * TILE_SIZE_BYTES;
 
 // Tile map addresses
 constexpr uint16_t TILE_MAP_BASE_0 = 0x9800;
@@ -60,6 +62,7 @@ constexpr uint8_t TILE_PIXELS_PER_ROW = 8;
 // Mode 3 penalty
 constexpr uint8_t MODE_3_WINDOW_SWITCH_PENALTY = 6;
 constexpr uint8_t MODE_3_SCX_PENALTY_DIVISOR = 8;
+constexpr uint8_t MODE_3_FIRST_PIXEL_CYCLES = 12;  // Fetching the first tile, before any pixel is pushed out
 
 // Window constants
 constexpr uint8_t WINDOW_X_OFFSET = 7;
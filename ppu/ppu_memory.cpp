@@ -1,4 +1,5 @@
 #include "ppu_memory.h"
+#include <bit>
 #include <cstring>
 #include "ppu_constants.h"
 #include "save_state.h"
@@ -6,15 +7,49 @@
 static_assert(VRAM_SIZE == 1024 * 8, "VRAM_SIZE must be 8192 bytes");
 static_assert(OAM_SIZE == 160, "OAM_SIZE must be 160 bytes");
 
-PPUMemory::PPUMemory(const PPURegisters& ppu_registers) : ppu_registers_(ppu_registers) {
+PPUMemory::PPUMemory(const PPURegisters& ppu_registers)
+    : ppu_registers_(ppu_registers), tile_maps_(std::make_unique<TileMapCache>()) {
   memset(vram_.data(), 0, sizeof(vram_));
   memset(oam_.data(), 0, sizeof(oam_));
+  invalidate_decoded_vram();
 }
 
-void PPUMemory::tick() {
+void PPUMemory::invalidate_decoded_vram() {
+  dirty_tiles_.fill(~0ull);
+  tile_maps_->reset(vram_.data());
+}
+
+void PPUMemory::load_vram(const std::array<unsigned char, VRAM_SIZE>& vram) {
+  vram_ = vram;
+  invalidate_state_hash();
+  invalidate_decoded_vram();
+}
+
+void PPUMemory::refresh_decoded_vram(bool unsigned_tile_data) {
+  for (uint32_t word = 0; word < dirty_tiles_.size(); word++) {
+    for (uint64_t dirty = dirty_tiles_[word]; dirty != 0; dirty &= dirty - 1) {
+      const uint32_t tile = word * 64 + std::countr_zero(dirty);
+      const uint8_t* data = &vram_[tile * TILE_SIZE_BYTES];
+      for (uint32_t row = 0; row < TILE_HEIGHT; row++) {
+        const uint8_t* planes = data + row * TileRow::BYTES_PER_TILE_ROW;
+        const uint64_t indices = TileRow::decode(planes[0], planes[1]);
+        decoded_tiles_[tile][row] = indices;
+        flipped_tiles_[tile][row] = TileRow::flip(indices);
+      }
+      tile_maps_->tile_changed(tile, unsigned_tile_data);
+    }
+    dirty_tiles_[word] = 0;
+  }
+  tile_maps_->refresh(vram_.data(), decoded_tiles_, unsigned_tile_data);
+}
+
+void PPUMemory::tick(const std::function<const uint8_t*(uint16_t)>& read_memory) {
   // Tick OAMDMA transfers
+  if (!oam_dmas_.empty()) {
+    oam_generation_++;
+  }
   for (auto it = oam_dmas_.begin(); it != oam_dmas_.end();) {
-    if (it->tick()) {
+    if (it->tick(read_memory, oam_)) {
       it = oam_dmas_.erase(it);
       PPU_VERBOSE_PRINT() << "OAMDMA completed: " << oam_dmas_.size() << std::endl;
     } else {
@@ -41,10 +76,11 @@ void PPUMemory::write_oam(uint16_t addr, uint8_t value) {
   }
 
   oam_[addr - OAM_BASE_ADDRESS] = value;
+  oam_generation_++;
 }
 
-void PPUMemory::start_oamdma(std::function<const uint8_t*(uint16_t)> read_memory, uint16_t source_address) {
-  oam_dmas_.emplace_back(read_memory, oam_, source_address);
+void PPUMemory::start_oamdma(uint16_t source_address) {
+  oam_dmas_.emplace_back(source_address);
 }
 
 void PPUMemory::serialize(SaveStateSerializer& serializer) const {
@@ -57,10 +93,16 @@ void PPUMemory::deserialize(SaveStateSerializer& serializer) {
   serializer >> vram_;
   serializer >> oam_;
   serializer >> oam_dmas_;
+  invalidate_state_hash();
+  invalidate_decoded_vram();
+  oam_generation_++;
 }
 
-void PPUMemory::restore_oamdma_pointers(std::function<const uint8_t*(uint16_t)> read_memory) {
-  for (auto& oam_dma : oam_dmas_) {
-    oam_dma.restore_pointers(read_memory, oam_);
+uint64_t PPUMemory::state_hash(uint64_t seed) {
+  uint64_t hash = hash_object(vram_hash_.hash(vram_.data()), seed);
+  hash = hash_object(oam_, hash);
+  for (const auto& oam_dma : oam_dmas_) {
+    hash = hash_object(oam_dma, hash);
   }
+  return hash;
 }
@@ -3,9 +3,13 @@
 #include <array>
 #include <cstdint>
 #include <functional>
+#include <memory>
 #include "oamdma.h"
 #include "ppu_registers.h"
 #include "stack_vector.h"
+#include "state_hash.h"
+#include "tile_map_cache.h"
+#include "tile_row.h"
 
 class SaveStateSerializer;
 
@@ -13,31 +17,69 @@ class PPUMemory {
 public:
   PPUMemory(const PPURegisters& ppu_registers);
 
-  void tick();
+  // read_memory is how OAM DMA transfers read their source
+  void tick(const std::function<const uint8_t*(uint16_t)>& read_memory);
 
   // VRAM access
   const uint8_t* read_vram(uint16_t addr) const { return &vram_[addr - VRAM_BASE_ADDRESS]; }
-  void write_vram(uint16_t addr, uint8_t value) { vram_[addr - VRAM_BASE_ADDRESS] = value; }
+  void write_vram(uint16_t addr, uint8_t value) {
+    const uint16_t offset = addr - VRAM_BASE_ADDRESS;
+    if (offset < TILE_DATA_SIZE) {
+      const uint16_t tile = offset / TILE_SIZE_BYTES;
+      dirty_tiles_[tile / 64] |= 1ull << (tile % 64);
+    } else if (vram_[offset] != value) {
+      tile_maps_->map_written(offset - TILE_DATA_SIZE, vram_[offset], value);
+    }
+    vram_[offset] = value;
+    vram_hash_.mark(offset);
+  }
+
+  // Tile data decoded to colour indices, the same mirrored for objects flipped in X, and both tile maps drawn out
+  // with the tile data addressing unsigned_tile_data (LCDC bit 4). VRAM written since the last call is only decoded
+  // again by refresh_decoded_vram, which must be called before reading these.
+  void refresh_decoded_vram(bool unsigned_tile_data);
+  const TileRow::DecodedTiles& decoded_tiles() const { return decoded_tiles_; }
+  const TileRow::DecodedTiles& flipped_tiles() const { return flipped_tiles_; }
+  const TileMapCache& tile_maps() const { return *tile_maps_; }
 
   // OAM access
   const uint8_t* read_oam(uint16_t addr) const;
   void write_oam(uint16_t addr, uint8_t value);
+  // Changes whenever OAM might have, so anything derived from it knows to rebuild
+  uint32_t oam_generation() const { return oam_generation_; }
 
   // OAMDMA management
-  void start_oamdma(std::function<const uint8_t*(uint16_t)> read_memory, uint16_t source_address);
+  void start_oamdma(uint16_t source_address);
   bool is_oam_dma_running() const { return !oam_dmas_.empty() && oam_dmas_.front().running(); }
 
   // Direct access for sub-components
   const std::array<unsigned char, VRAM_SIZE>& vram() const { return vram_; }
+  // Replaces all of VRAM, as loading a save state does
+  void load_vram(const std::array<unsigned char, VRAM_SIZE>& vram);
   std::array<unsigned char, OAM_SIZE>& oam() { return oam_; }
 
+  // VRAM comes first in the serialized layout so tools can read it straight out of a save state section
+  static constexpr uint32_t SAVE_STATE_VERSION = 1;
   void serialize(SaveStateSerializer& serializer) const;
   void deserialize(SaveStateSerializer& serializer);
-  void restore_oamdma_pointers(std::function<const uint8_t*(uint16_t)> read_memory);
+
+  // Only rehashes VRAM written since the last call
+  uint64_t state_hash(uint64_t seed);
+  void invalidate_state_hash() { vram_hash_.mark_all(); }
 
 private:
   std::array<unsigned char, VRAM_SIZE> vram_;
   std::array<unsigned char, OAM_SIZE> oam_;
   StackVector<OAMDMA, OAM_DMA_MAX_COUNT> oam_dmas_;
+  uint32_t oam_generation_ = 0;
   const PPURegisters& ppu_registers_;
+  PagedHash<VRAM_SIZE> vram_hash_;
+
+  void invalidate_decoded_vram();
+
+  TileRow::DecodedTiles decoded_tiles_;
+  TileRow::DecodedTiles flipped_tiles_;
+  std::array<uint64_t, TILE_COUNT / 64> dirty_tiles_;  // One bit per tile
+  // On the heap, as the bitmaps would more than double the size of a MainLoop, which front ends keep on the stack
+  std::unique_ptr<TileMapCache> tile_maps_;
 };
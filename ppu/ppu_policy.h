@@ -0,0 +1,17 @@
+#pragma once
+
+// The renderer the emulator's PPU is built with, chosen at compile time so the fast build carries nothing of the
+// accurate one. ScanlineRenderer draws each line in one go and is the default; configuring with GBEMU_FIFO_PPU=ON
+// swaps in FifoRenderer, which runs the pixel fetcher and FIFOs dot by dot and times mode 3 by them.
+
+class ScanlineRenderer;
+class FifoRenderer;
+
+template <typename Renderer>
+class BasicPPU;
+
+#ifdef GBEMU_FIFO_PPU
+using PPU = BasicPPU<FifoRenderer>;
+#else
+using PPU = BasicPPU<ScanlineRenderer>;
+#endif
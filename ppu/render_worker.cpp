@@ -0,0 +1,79 @@
+#include "render_worker.h"
+
+RenderWorker::RenderWorker(GameScreen& screen)
+    : registers_(false),
+      memory_(registers_),
+      renderer_(memory_, screen),
+      queue_(std::make_unique<SPSCQueue<Command, QUEUE_SIZE>>()),
+      lines_(std::make_unique<SPSCQueue<LineSnapshot, LINE_QUEUE_SIZE>>()),
+      thread_([this]() { run(); }) {}
+
+RenderWorker::~RenderWorker() {
+  push(*queue_, {Command::Type::Stop}, true);
+  thread_.join();
+}
+
+void RenderWorker::write_vram(uint16_t addr, uint8_t value) {
+  // Nothing reads VRAM until the next line, so there is no need to wake the worker for it
+  push(*queue_, {Command::Type::WriteVram, value, addr}, false);
+}
+
+void RenderWorker::draw_line(const LineSnapshot& line) {
+  push(*lines_, line, false);
+  push(*queue_, {Command::Type::DrawLine}, true);
+}
+
+void RenderWorker::finish_frame() {
+  push(*queue_, {Command::Type::Fence}, true);
+  fences_pushed_++;
+  for (uint32_t passed = fences_passed_.load(std::memory_order_acquire); passed != fences_pushed_;
+       passed = fences_passed_.load(std::memory_order_acquire)) {
+    fences_passed_.wait(passed, std::memory_order_acquire);
+  }
+}
+
+void RenderWorker::load_vram(const std::array<unsigned char, VRAM_SIZE>& vram) {
+  // Once the worker is idle it touches nothing until the next push, which publishes the new VRAM to it
+  finish_frame();
+  memory_.load_vram(vram);
+}
+
+template <typename T, size_t N>
+void RenderWorker::push(SPSCQueue<T, N>& queue, const T& item, bool wake) {
+  while (!queue.try_push(item)) {
+    // Full, so make sure the worker is draining it. The worker only sleeps on queue_, so that is the one to wake.
+    queue_->wake_consumer();
+    std::this_thread::yield();
+  }
+  if (wake) {
+    queue.wake_consumer();
+  }
+}
+
+void RenderWorker::run() {
+  while (true) {
+    const Command* command = queue_->front();
+    if (command == nullptr) {
+      queue_->wait_for_item();
+      continue;
+    }
+
+    switch (command->type) {
+      case Command::Type::WriteVram:
+        memory_.write_vram(command->address, command->value);
+        break;
+      case Command::Type::DrawLine:
+        renderer_.draw(*lines_->front());
+        lines_->pop();
+        break;
+      case Command::Type::Fence:
+        fences_passed_.fetch_add(1, std::memory_order_release);
+        fences_passed_.notify_one();
+        break;
+      case Command::Type::Stop:
+        queue_->pop();
+        return;
+    }
+    queue_->pop();
+  }
+}
@@ -0,0 +1,57 @@
+#pragma once
+
+#include <array>
+#include <atomic>
+#include <cstdint>
+#include <memory>
+#include <thread>
+#include "game_screen.h"
+#include "ppu_memory.h"
+#include "ppu_registers.h"
+#include "scanline_renderer.h"
+#include "spsc_queue.h"
+
+// Draws scanlines on a thread of its own. The PPU hands over a snapshot of each line as it enters mode 3 and
+// every VRAM write in between, in order, and the worker replays them against its own copy of VRAM, so lines come
+// out exactly as if they had been drawn on the emulation thread. Only the emulation thread may call these.
+class RenderWorker {
+public:
+  // Lines are drawn onto screen, which the caller must leave alone until finish_frame returns
+  explicit RenderWorker(GameScreen& screen);
+  ~RenderWorker();
+
+  void write_vram(uint16_t addr, uint8_t value);
+  void draw_line(const LineSnapshot& line);
+
+  // Waits until every line handed over so far has been drawn
+  void finish_frame();
+
+  // Replaces the worker's copy of VRAM, for when VRAM changed without write_vram seeing it
+  void load_vram(const std::array<unsigned char, VRAM_SIZE>& vram);
+
+private:
+  // Kept to the size of a VRAM write, the bulk of the traffic. Each DrawLine takes the next snapshot from lines_.
+  struct Command {
+    enum class Type : uint8_t { WriteVram, DrawLine, Fence, Stop };
+    Type type;
+    uint8_t value;
+    uint16_t address;
+  };
+
+  // Enough for a frame of lines and a few thousand VRAM writes between them before the emulation thread waits
+  static constexpr size_t QUEUE_SIZE = 4096;
+  static constexpr size_t LINE_QUEUE_SIZE = 256;
+
+  template <typename T, size_t N>
+  void push(SPSCQueue<T, N>& queue, const T& item, bool wake);
+  void run();
+
+  PPURegisters registers_;  // Never changes; PPUMemory only reads it for OAM access, which the worker doesn't use
+  PPUMemory memory_;
+  ScanlineRenderer renderer_;
+  std::unique_ptr<SPSCQueue<Command, QUEUE_SIZE>> queue_;
+  std::unique_ptr<SPSCQueue<LineSnapshot, LINE_QUEUE_SIZE>> lines_;  // Pushed before their DrawLine commands
+  uint32_t fences_pushed_ = 0;
+  std::atomic<uint32_t> fences_passed_ = 0;
+  std::thread thread_;
+};
@@ -15,11 +15,3 @@ constexpr uint32_t make_argb(uint8_t r, uint8_t g, uint8_t b) {
 constexpr RGBValue make_rgb(uint8_t r, uint8_t g, uint8_t b) {
   return RGBValue{make_argb(r, g, b), 0};
 }
-
-struct RGBAValue : public RGBValue {
-  RGBAValue() = default;
-  RGBAValue(const RGBAValue&) = default;
-  RGBAValue(RGBValue rgb, bool active, bool priority) : RGBValue(rgb), active(active), priority(priority) {}
-  bool active = false;
-  bool priority = false;
-};
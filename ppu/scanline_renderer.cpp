@@ -0,0 +1,148 @@
+#include "scanline_renderer.h"
+#include <algorithm>
+#include "object_line.h"
+#include "palette.h"
+#include "ppu_registers.h"
+#include "tile_row.h"
+
+namespace {
+// Background and window switched off draw plain white, whatever BGP says
+constexpr std::array<uint8_t, 4> BLANK_SHADES = {0, 0, 0, 0};
+
+void apply_change(LineSnapshot& state, const RegisterChange& change) {
+  switch (change.offset) {
+    case REGISTER_OFFSET_LCDC:
+      state.lcdc = change.value;
+      break;
+    case REGISTER_OFFSET_SCY:
+      state.scy = change.value;
+      break;
+    case REGISTER_OFFSET_SCX:
+      state.scx = change.value;
+      break;
+    case REGISTER_OFFSET_BGP:
+      state.bgp = change.value;
+      break;
+    case REGISTER_OFFSET_OBP0:
+      state.obp0 = change.value;
+      break;
+    case REGISTER_OFFSET_OBP1:
+      state.obp1 = change.value;
+      break;
+    case REGISTER_OFFSET_WX:
+      state.wx = change.value;
+      break;
+    default:
+      break;
+  }
+}
+
+// Calls draw(state, x, count) for each non-empty span of the line, with the registers as they were over it
+template <typename Draw>
+void for_each_span(const LineSnapshot& line, Draw draw) {
+  LineSnapshot state = line;
+  uint32_t x = 0;
+  for (uint32_t i = 0; i <= line.change_count; i++) {
+    const uint32_t end = i < line.change_count ? line.changes[i].x : SCREEN_WIDTH;
+    if (end > x) {
+      draw(state, x, end - x);
+      x = end;
+    }
+    if (i < line.change_count) {
+      apply_change(state, line.changes[i]);
+    }
+  }
+}
+}  // namespace
+
+void ScanlineRenderer::draw(const LineSnapshot& line) {
+  memory_.refresh_decoded_vram(line.lcdc & LCDC_TILE_DATA);
+  if (line.change_count != 0) {
+    draw_split(line);
+    return;
+  }
+  draw_background(line);
+  draw_objects(line);
+}
+
+void ScanlineRenderer::fetch_background(const LineSnapshot& line, bool map_bitmaps, uint8_t* indices) {
+  // Window X position is WX - 7, and the window covers every pixel from there to the right edge
+  uint32_t window_start = SCREEN_WIDTH;
+  if (line.window_visible && (line.lcdc & LCDC_WINDOW_ENABLE)) {
+    window_start = std::min<uint32_t>(std::max(line.wx, WINDOW_X_OFFSET) - WINDOW_X_OFFSET, SCREEN_WIDTH);
+  }
+
+  if (map_bitmaps) {
+    memory_.tile_maps().fetch_line(line.lcdc, line.scx, line.scanline + line.scy, window_start, line.wx,
+                                   line.window_line, indices);
+  } else {
+    TileRow::fetch_line(memory_.vram().data(), memory_.decoded_tiles(), line.lcdc, line.scx,
+                        line.scanline + line.scy, window_start, line.wx, line.window_line, indices);
+  }
+}
+
+void ScanlineRenderer::draw_background(const LineSnapshot& line) {
+  std::array<uint8_t, SCREEN_WIDTH> indices;
+
+  if ((line.lcdc & LCDC_BG_ENABLE) == 0) {
+    indices.fill(0);
+    screen_.draw_background_line(line.scanline, indices.data(), BLANK_SHADES);
+    return;
+  }
+
+  fetch_background(line, true, indices.data());
+  screen_.draw_background_line(line.scanline, indices.data(), Palette::shades(line.bgp));
+}
+
+void ScanlineRenderer::fetch_objects(const LineSnapshot& line, ObjectLine::Buffer& pixels) {
+  std::array<ObjectAttribute*, MAX_SPRITES_PER_SCANLINE> objects = {};
+  std::array<ObjectAttribute, MAX_SPRITES_PER_SCANLINE> copies = line.objects;
+  for (uint32_t i = 0; i < line.object_count; i++) {
+    objects[i] = &copies[i];
+  }
+  ObjectLine::draw_objects(pixels, objects, line.scanline, line.lcdc & LCDC_SPRITE_SIZE, memory_.decoded_tiles(),
+                           memory_.flipped_tiles());
+}
+
+void ScanlineRenderer::draw_objects(const LineSnapshot& line) {
+  if ((line.lcdc & LCDC_SPRITE_ENABLE) == 0 || line.object_count == 0) {
+    return;
+  }
+
+  ObjectLine::Buffer pixels = {};
+  fetch_objects(line, pixels);
+  screen_.draw_object_line(line.scanline, pixels.data() + ObjectLine::SLACK,
+                           Palette::object_shades(line.obp0, line.obp1));
+}
+
+void ScanlineRenderer::draw_split(const LineSnapshot& line) {
+  // The tile map bitmaps are drawn for the tile data addressing the line started with; spans switched to the other
+  // fetch tile by tile instead, rather than redraw both maps twice a line
+  const bool unsigned_tile_data = (line.lcdc & LCDC_TILE_DATA) != 0;
+  std::array<uint8_t, SCREEN_WIDTH + 2 * TILE_WIDTH> buffer = {};  // Slack either side for TileRow::fetch_line
+  uint8_t* indices = buffer.data() + TILE_WIDTH;
+  for_each_span(line, [&](const LineSnapshot& state, uint32_t x, uint32_t count) {
+    if ((state.lcdc & LCDC_BG_ENABLE) == 0) {
+      std::fill_n(indices + x, count, 0);
+      screen_.draw_background_span(line.scanline, x, count, indices + x, BLANK_SHADES);
+      return;
+    }
+    fetch_background(state, ((state.lcdc & LCDC_TILE_DATA) != 0) == unsigned_tile_data, indices);
+    screen_.draw_background_span(line.scanline, x, count, indices + x, Palette::shades(state.bgp));
+  });
+
+  if (line.object_count == 0) {
+    return;
+  }
+
+  // Which objects are on the line and their height were settled during OAM search, so they are drawn once and
+  // only shown through each span's palettes
+  ObjectLine::Buffer pixels = {};
+  fetch_objects(line, pixels);
+  for_each_span(line, [&](const LineSnapshot& state, uint32_t x, uint32_t count) {
+    if (state.lcdc & LCDC_SPRITE_ENABLE) {
+      screen_.draw_object_span(line.scanline, x, count, pixels.data() + ObjectLine::SLACK,
+                               Palette::object_shades(state.obp0, state.obp1));
+    }
+  });
+}
@@ -0,0 +1,62 @@
+#pragma once
+
+#include <array>
+#include <cstdint>
+#include "game_screen.h"
+#include "object_attributes.h"
+#include "object_line.h"
+#include "ppu_constants.h"
+#include "ppu_memory.h"
+
+// A write to one of the registers drawing reads, made while the line was being drawn
+struct RegisterChange {
+  uint8_t x;         // First pixel drawn with the new value
+  uint8_t offset;  // Register address less PPU_REGISTER_START
+  uint8_t value;
+};
+
+// Raster effects rarely change more than a couple of registers per line; writes past this many are dropped
+constexpr uint32_t MAX_LINE_CHANGES = 16;
+
+// Everything drawing a scanline reads apart from VRAM, captured as the line enters mode 3 so it can be drawn
+// later, on another thread, and come out the same as if drawn right then. Register writes during mode 3 are logged
+// in changes, in order, and split the line into spans each drawn with the registers as they were then.
+struct LineSnapshot {
+  std::array<ObjectAttribute, MAX_SPRITES_PER_SCANLINE> objects;  // Copies, in priority order
+  uint8_t object_count;
+  uint8_t scanline;
+  uint8_t lcdc;
+  uint8_t scx;
+  uint8_t scy;
+  uint8_t wx;
+  uint8_t bgp;
+  uint8_t obp0;
+  uint8_t obp1;
+  uint8_t window_line;  // Window line counter, valid when window_visible
+  bool window_visible;
+  uint8_t change_count;
+  std::array<RegisterChange, MAX_LINE_CHANGES> changes;
+};
+
+// Draws scanlines from snapshots and the VRAM in memory onto screen
+class ScanlineRenderer {
+public:
+  // The PPU works out mode 3's length itself and hands over each line to draw as mode 3 ends
+  static constexpr bool DOT_TIMED = false;
+
+  ScanlineRenderer(PPUMemory& memory, GameScreen& screen) : memory_(memory), screen_(screen) {}
+
+  void draw(const LineSnapshot& line);
+
+private:
+  void draw_background(const LineSnapshot& line);
+  void draw_objects(const LineSnapshot& line);
+
+  // Lines with register changes, drawn a span at a time between them
+  void draw_split(const LineSnapshot& line);
+  void fetch_background(const LineSnapshot& line, bool map_bitmaps, uint8_t* indices);
+  void fetch_objects(const LineSnapshot& line, ObjectLine::Buffer& pixels);
+
+  PPUMemory& memory_;
+  GameScreen& screen_;
+};
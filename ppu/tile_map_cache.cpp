@@ -0,0 +1,77 @@
+#include "tile_map_cache.h"
+#include <algorithm>
+#include <bit>
+#include <cstring>
+
+void TileMapCache::tile_changed(uint32_t tile, bool unsigned_tile_data) {
+  // Each tile has at most one index in either addressing mode: unsigned covers tiles 0-255 and signed 128-383
+  constexpr uint32_t SIGNED_FIRST_TILE = 128;
+  constexpr uint32_t UNSIGNED_TILE_COUNT = 256;
+  if (unsigned_tile_data ? tile >= UNSIGNED_TILE_COUNT : tile < SIGNED_FIRST_TILE) {
+    return;
+  }
+  const uint8_t index = static_cast<uint8_t>(tile);
+  for (uint32_t map = 0; map < MAP_COUNT; map++) {
+    for (uint32_t word = 0; word < dirty_cells_[map].size(); word++) {
+      dirty_cells_[map][word] |= cells_by_index_[map][index][word];
+    }
+  }
+}
+
+void TileMapCache::refresh(const uint8_t* vram, const TileRow::DecodedTiles& tiles, bool unsigned_tile_data) {
+  if (unsigned_tile_data != unsigned_tile_data_) {
+    for (CellSet& dirty : dirty_cells_) {
+      dirty.fill(~0ull);
+    }
+    unsigned_tile_data_ = unsigned_tile_data;
+  }
+
+  for (uint32_t map = 0; map < MAP_COUNT; map++) {
+    for (uint32_t word = 0; word < dirty_cells_[map].size(); word++) {
+      for (uint64_t dirty = dirty_cells_[map][word]; dirty != 0; dirty &= dirty - 1) {
+        draw_cell(vram, tiles, map, word * 64 + std::countr_zero(dirty));
+      }
+      dirty_cells_[map][word] = 0;
+    }
+  }
+}
+
+void TileMapCache::draw_cell(const uint8_t* vram, const TileRow::DecodedTiles& tiles, uint32_t map, uint32_t cell) {
+  const uint8_t tile_index = vram[TILE_MAP_BASE_0 - VRAM_BASE_ADDRESS + map * CELLS + cell];
+  const auto& tile = tiles[TileRow::bgwin_tile(tile_index, unsigned_tile_data_)];
+  const uint32_t x = (cell % TILES_PER_ROW) * TILE_WIDTH;
+  const uint32_t y = (cell / TILES_PER_ROW) * TILE_HEIGHT;
+  for (uint32_t row = 0; row < TILE_HEIGHT; row++) {
+    TileRow::store(&bitmaps_[map][y + row][x], tile[row]);
+  }
+}
+
+void TileMapCache::reset(const uint8_t* vram) {
+  for (uint32_t map = 0; map < MAP_COUNT; map++) {
+    for (CellSet& cells : cells_by_index_[map]) {
+      cells.fill(0);
+    }
+    for (uint32_t cell = 0; cell < CELLS; cell++) {
+      const uint8_t tile_index = vram[TILE_MAP_BASE_0 - VRAM_BASE_ADDRESS + map * CELLS + cell];
+      cells_by_index_[map][tile_index][cell / 64] |= 1ull << (cell % 64);
+    }
+    dirty_cells_[map].fill(~0ull);
+  }
+}
+
+void TileMapCache::fetch_line(uint8_t lcdc, uint8_t scx, uint8_t background_y, uint32_t window_start, uint8_t wx,
+                              uint8_t window_y, uint8_t* line) const {
+  if (window_start > 0) {
+    // The background wraps around at the right edge of its map
+    const uint8_t* row = bitmaps_[(lcdc & LCDC_BG_TILE_MAP) ? 1 : 0][background_y].data();
+    const uint32_t first = std::min<uint32_t>(window_start, MAP_SIZE - scx);
+    memcpy(line, row + scx, first);
+    memcpy(line + first, row, window_start - first);
+  }
+  if (window_start < SCREEN_WIDTH) {
+    // The window starts at most 7 pixels into its map, so never wraps
+    const uint8_t* row = bitmaps_[(lcdc & LCDC_WINDOW_TILE_MAP) ? 1 : 0][window_y].data();
+    const uint8_t window_x = window_start + WINDOW_X_OFFSET - wx;
+    memcpy(line + window_start, row + window_x, SCREEN_WIDTH - window_start);
+  }
+}
@@ -0,0 +1,50 @@
+#pragma once
+
+#include <array>
+#include <cstdint>
+#include "ppu_constants.h"
+#include "tile_row.h"
+
+// Both 32x32 tile maps drawn out as 256x256 bitmaps of colour indices, so a background or window scanline is a
+// copy out of them. A cell is redrawn on the next refresh after its tile map entry, the tile it shows or the tile
+// data addressing changes. The cells showing a tile are found through a reverse map from tile index to cells,
+// kept up to date as the tile maps are written.
+class TileMapCache {
+public:
+  static constexpr uint32_t MAP_COUNT = 2;
+  static constexpr uint32_t MAP_SIZE = 256;  // Pixels each way
+  static constexpr uint32_t CELLS = TILES_PER_ROW * TILES_PER_ROW;
+
+  // The tile map entry at offset from 0x9800 is changing from old_index to new_index
+  void map_written(uint32_t offset, uint8_t old_index, uint8_t new_index) {
+    const uint32_t map = offset / CELLS;
+    const uint32_t cell = offset % CELLS;
+    cells_by_index_[map][old_index][cell / 64] &= ~(1ull << (cell % 64));
+    cells_by_index_[map][new_index][cell / 64] |= 1ull << (cell % 64);
+    dirty_cells_[map][cell / 64] |= 1ull << (cell % 64);
+  }
+
+  // Marks every cell showing tile when tiles are addressed with unsigned_tile_data (LCDC bit 4)
+  void tile_changed(uint32_t tile, bool unsigned_tile_data);
+
+  // Redraws the marked cells from tiles, or every cell if unsigned_tile_data has changed. vram starts at 0x8000.
+  void refresh(const uint8_t* vram, const TileRow::DecodedTiles& tiles, bool unsigned_tile_data);
+
+  // Starts over from the tile maps in vram, for when VRAM is replaced wholesale
+  void reset(const uint8_t* vram);
+
+  // Colour indices of a whole scanline into line[0, SCREEN_WIDTH), as TileRow::fetch_line but copied out of the
+  // bitmaps: the background at SCX, background_y up to window_start, then the window from its left edge.
+  void fetch_line(uint8_t lcdc, uint8_t scx, uint8_t background_y, uint32_t window_start, uint8_t wx,
+                  uint8_t window_y, uint8_t* line) const;
+
+private:
+  using CellSet = std::array<uint64_t, CELLS / 64>;
+
+  void draw_cell(const uint8_t* vram, const TileRow::DecodedTiles& tiles, uint32_t map, uint32_t cell);
+
+  std::array<std::array<std::array<uint8_t, MAP_SIZE>, MAP_SIZE>, MAP_COUNT> bitmaps_;
+  std::array<std::array<CellSet, 256>, MAP_COUNT> cells_by_index_;
+  std::array<CellSet, MAP_COUNT> dirty_cells_;
+  bool unsigned_tile_data_ = true;  // The addressing the bitmaps were drawn with
+};
@@ -0,0 +1,113 @@
+#include "tile_row.h"
+#include "ppu_constants.h"
+
+#ifdef __SSE2__
+#include <emmintrin.h>
+#endif
+
+namespace TileRow {
+
+void fetch_map_span(const uint8_t* vram, const DecodedTiles& tiles, uint16_t tile_map_base, bool unsigned_tile_data,
+                    uint8_t map_x, uint8_t map_y, uint8_t* out, uint32_t count) {
+  const uint8_t* map_row = vram + (tile_map_base - VRAM_BASE_ADDRESS) + (map_y / TILE_HEIGHT) * TILES_PER_ROW;
+  const uint32_t tile_y = map_y % TILE_HEIGHT;
+  const uint32_t first_column = map_x / TILE_WIDTH;
+  const uint32_t fine_x = map_x % TILE_WIDTH;
+  const uint32_t tile_count = (fine_x + count + TILE_WIDTH - 1) / TILE_WIDTH;
+
+  uint8_t* tile_out = out - fine_x;
+  for (uint32_t i = 0; i < tile_count; i++, tile_out += TILE_WIDTH) {
+    const uint8_t tile_index = map_row[(first_column + i) % TILES_PER_ROW];
+    store(tile_out, tiles[bgwin_tile(tile_index, unsigned_tile_data)][tile_y]);
+  }
+}
+
+void fetch_line(const uint8_t* vram, const DecodedTiles& tiles, uint8_t lcdc, uint8_t scx, uint8_t background_y,
+                uint32_t window_start, uint8_t wx, uint8_t window_y, uint8_t* line) {
+  const bool unsigned_tile_data = (lcdc & LCDC_TILE_DATA) != 0;
+  if (window_start > 0) {
+    const uint16_t tile_map_base = (lcdc & LCDC_BG_TILE_MAP) ? TILE_MAP_BASE_1 : TILE_MAP_BASE_0;
+    fetch_map_span(vram, tiles, tile_map_base, unsigned_tile_data, scx, background_y, line, window_start);
+  }
+  if (window_start < SCREEN_WIDTH) {
+    // The window has its own coordinates starting at (0,0). Its span goes second, as only a window starting
+    // off the left edge begins mid-tile and fetching it never overwrites background pixels.
+    const uint16_t tile_map_base = (lcdc & LCDC_WINDOW_TILE_MAP) ? TILE_MAP_BASE_1 : TILE_MAP_BASE_0;
+    const uint8_t window_x = window_start + WINDOW_X_OFFSET - wx;
+    fetch_map_span(vram, tiles, tile_map_base, unsigned_tile_data, window_x, window_y, line + window_start,
+                   SCREEN_WIDTH - window_start);
+  }
+}
+
+void apply_shades(const uint8_t* indices, const std::array<uint8_t, 4>& shades, uint8_t* out, uint32_t count) {
+  uint32_t i = 0;
+#ifdef __SSE2__
+  // 16 pixels at a time, each picking its shade by comparing against all four indices as apply_palette does
+  constexpr uint32_t LANES = sizeof(__m128i);
+  __m128i shade_bytes[4];
+  for (int index = 0; index < 4; index++) {
+    shade_bytes[index] = _mm_set1_epi8(static_cast<char>(shades[index]));
+  }
+  for (; i + LANES <= count; i += LANES) {
+    const __m128i packed = _mm_loadu_si128(reinterpret_cast<const __m128i*>(indices + i));
+    __m128i result = _mm_and_si128(_mm_cmpeq_epi8(packed, _mm_setzero_si128()), shade_bytes[0]);
+    for (int index = 1; index < 4; index++) {
+      const __m128i matches = _mm_cmpeq_epi8(packed, _mm_set1_epi8(static_cast<char>(index)));
+      result = _mm_or_si128(result, _mm_and_si128(matches, shade_bytes[index]));
+    }
+    _mm_storeu_si128(reinterpret_cast<__m128i*>(out + i), result);
+  }
+#endif
+  for (; i + TILE_WIDTH <= count; i += TILE_WIDTH) {
+    uint64_t packed;
+    memcpy(&packed, indices + i, sizeof(packed));
+    const uint64_t result = shade(packed, shades);
+    memcpy(out + i, &result, sizeof(result));
+  }
+  for (; i < count; i++) {
+    out[i] = shades[indices[i]];
+  }
+}
+
+void apply_palette_scalar(const uint8_t* indices, const std::array<RGBValue, 4>& colors, uint32_t* out,
+                          uint32_t count) {
+  const uint32_t argb[4] = {colors[0].argb, colors[1].argb, colors[2].argb, colors[3].argb};
+  for (uint32_t i = 0; i < count; i++) {
+    out[i] = argb[indices[i]];
+  }
+}
+
+#ifdef __SSE2__
+namespace {
+// SSE2 has no byte shuffle, so each lane picks its colour by comparing against all four indices
+[[gnu::always_inline]] inline __m128i lookup(__m128i indices, const __m128i* argb) {
+  __m128i result = _mm_and_si128(_mm_cmpeq_epi32(indices, _mm_setzero_si128()), argb[0]);
+  for (int i = 1; i < 4; i++) {
+    result = _mm_or_si128(result, _mm_and_si128(_mm_cmpeq_epi32(indices, _mm_set1_epi32(i)), argb[i]));
+  }
+  return result;
+}
+}  // namespace
+
+void apply_palette(const uint8_t* indices, const std::array<RGBValue, 4>& colors, uint32_t* out, uint32_t count) {
+  const __m128i argb[4] = {_mm_set1_epi32(static_cast<int>(colors[0].argb)),
+                           _mm_set1_epi32(static_cast<int>(colors[1].argb)),
+                           _mm_set1_epi32(static_cast<int>(colors[2].argb)),
+                           _mm_set1_epi32(static_cast<int>(colors[3].argb))};
+  const __m128i zero = _mm_setzero_si128();
+  uint32_t i = 0;
+  for (; i + TILE_WIDTH <= count; i += TILE_WIDTH) {
+    const __m128i bytes = _mm_loadl_epi64(reinterpret_cast<const __m128i*>(indices + i));
+    const __m128i words = _mm_unpacklo_epi8(bytes, zero);
+    _mm_storeu_si128(reinterpret_cast<__m128i*>(out + i), lookup(_mm_unpacklo_epi16(words, zero), argb));
+    _mm_storeu_si128(reinterpret_cast<__m128i*>(out + i + 4), lookup(_mm_unpackhi_epi16(words, zero), argb));
+  }
+  apply_palette_scalar(indices + i, colors, out + i, count - i);
+}
+#else
+void apply_palette(const uint8_t* indices, const std::array<RGBValue, 4>& colors, uint32_t* out, uint32_t count) {
+  apply_palette_scalar(indices, colors, out, count);
+}
+#endif
+
+}  // namespace TileRow
@@ -0,0 +1,83 @@
+#pragma once
+
+#include <array>
+#include <bit>
+#include <cstdint>
+#include <cstring>
+#include "ppu_constants.h"
+#include "rgb.h"
+
+// Tile rows are decoded 8 pixels at a time: each bitplane byte is spread out to one bit per byte through a
+// lookup table, so a whole row of colour indices comes out of two lookups, a shift and an or.
+
+namespace TileRow {
+constexpr uint32_t BYTES_PER_TILE_ROW = 2;
+
+// Every row of every tile in tile data as decode packs it, indexed by tile number from 0x8000
+using DecodedTiles = std::array<std::array<uint64_t, TILE_HEIGHT>, TILE_COUNT>;
+
+constexpr std::array<uint64_t, 256> make_plane_lut() {
+  std::array<uint64_t, 256> lut = {};
+  for (uint32_t value = 0; value < 256; value++) {
+    for (uint32_t pixel = 0; pixel < 8; pixel++) {
+      // The leftmost pixel is bit 7 and goes in the first byte in memory
+      const uint32_t byte = std::endian::native == std::endian::little ? pixel : 7 - pixel;
+      lut[value] |= static_cast<uint64_t>((value >> (7 - pixel)) & 1) << (byte * 8);
+    }
+  }
+  return lut;
+}
+
+inline constexpr std::array<uint64_t, 256> PLANE_LUT = make_plane_lut();
+
+// The 8 colour indices of a tile row, one byte per pixel, ready to be copied to memory left to right
+[[gnu::always_inline]] inline uint64_t decode(uint8_t low_plane, uint8_t high_plane) {
+  return PLANE_LUT[low_plane] | (PLANE_LUT[high_plane] << 1);
+}
+
+// The same row mirrored, for objects flipped in X
+[[gnu::always_inline]] inline uint64_t flip(uint64_t indices) {
+  return __builtin_bswap64(indices);
+}
+
+[[gnu::always_inline]] inline void store(uint8_t* out, uint64_t indices) {
+  memcpy(out, &indices, sizeof(indices));
+}
+
+// Tile number of a background or window tile index. unsigned_tile_data is LCDC bit 4, otherwise indices are
+// signed and relative to 0x9000.
+[[gnu::always_inline]] inline uint32_t bgwin_tile(uint8_t tile_index, bool unsigned_tile_data) {
+  constexpr uint32_t SIGNED_BASE_TILE = (TILE_DATA_BASE_1 - TILE_DATA_BASE_0) / TILE_SIZE_BYTES;
+  return unsigned_tile_data ? tile_index : SIGNED_BASE_TILE + static_cast<int8_t>(tile_index);
+}
+
+// Colour indices of count pixels of tile map row map_y, starting at map_x and wrapping at 256, into out.
+// Whole tiles are written, so up to 7 bytes either side of out[0, count) are overwritten as well.
+// vram starts at 0x8000 and unsigned_tile_data is LCDC bit 4.
+void fetch_map_span(const uint8_t* vram, const DecodedTiles& tiles, uint16_t tile_map_base, bool unsigned_tile_data,
+                    uint8_t map_x, uint8_t map_y, uint8_t* out, uint32_t count);
+
+// Colour indices of a whole scanline into line[0, SCREEN_WIDTH), which needs TILE_WIDTH bytes of slack either side:
+// the background at SCX, background_y up to window_start, then the window from its left edge at line window_y.
+void fetch_line(const uint8_t* vram, const DecodedTiles& tiles, uint8_t lcdc, uint8_t scx, uint8_t background_y,
+                uint32_t window_start, uint8_t wx, uint8_t window_y, uint8_t* line);
+
+// Shades of 8 colour indices packed as decode packs them, through shades, a palette register split into its four
+// fields. Only the low two bits of each byte are looked at. Each byte's two index bits select one of four 0/1 masks,
+// and as the masks are disjoint and shades are at most 3, multiplying them by their shade never carries.
+[[gnu::always_inline]] inline uint64_t shade(uint64_t indices, const std::array<uint8_t, 4>& shades) {
+  constexpr uint64_t LOW_BITS = 0x0101010101010101ull;
+  const uint64_t low = indices & LOW_BITS;
+  const uint64_t high = (indices >> 1) & LOW_BITS;
+  return (~(low | high) & LOW_BITS) * shades[0] + (low & ~high) * shades[1] + (high & ~low) * shades[2] +
+         (low & high) * shades[3];
+}
+
+// Shades of count colour indices, as shade does them. Uses SSE2 where the target has it.
+void apply_shades(const uint8_t* indices, const std::array<uint8_t, 4>& shades, uint8_t* out, uint32_t count);
+
+// ARGB of count colour indices through colors. Uses SSE2 where the target has it.
+void apply_palette(const uint8_t* indices, const std::array<RGBValue, 4>& colors, uint32_t* out, uint32_t count);
+void apply_palette_scalar(const uint8_t* indices, const std::array<RGBValue, 4>& colors, uint32_t* out,
+                          uint32_t count);
+}  // namespace TileRow
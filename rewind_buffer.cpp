@@ -0,0 +1,178 @@
+#include "rewind_buffer.h"
+#include <algorithm>
+#include <cstring>
+
+namespace {
+// A run of at least this many unchanged bytes ends a literal block; shorter gaps are cheaper to copy through
+constexpr size_t MIN_UNCHANGED_RUN = 4;
+
+void write_varint(std::vector<uint8_t>& out, size_t value) {
+  while (value >= 0x80) {
+    out.push_back(static_cast<uint8_t>(value) | 0x80);
+    value >>= 7;
+  }
+  out.push_back(static_cast<uint8_t>(value));
+}
+
+size_t read_varint(const std::vector<uint8_t>& in, size_t& position) {
+  size_t value = 0;
+  int shift = 0;
+  while (position < in.size()) {
+    uint8_t byte = in[position++];
+    value |= static_cast<size_t>(byte & 0x7F) << shift;
+    if ((byte & 0x80) == 0) {
+      break;
+    }
+    shift += 7;
+  }
+  return value;
+}
+
+uint64_t load_u64(const uint8_t* data) {
+  uint64_t value;
+  memcpy(&value, data, sizeof(value));
+  return value;
+}
+}  // namespace
+
+RewindBuffer::RewindBuffer(size_t memory_budget_bytes, uint32_t keyframe_interval)
+    : memory_budget_bytes_(memory_budget_bytes), keyframe_interval_(std::max<uint32_t>(keyframe_interval, 1)) {}
+
+void RewindBuffer::push(const std::vector<uint8_t>& snapshot) {
+  const bool keyframe = entries_.empty() || frames_since_keyframe_ >= keyframe_interval_;
+
+  Entry entry{keyframe, {}};
+  if (keyframe) {
+    encode(snapshot, empty_reference_, entry.data);
+    keyframe_ = snapshot;
+    frames_since_keyframe_ = 1;
+    keyframe_count_++;
+  } else {
+    encode(snapshot, keyframe_, entry.data);
+    frames_since_keyframe_++;
+  }
+  memory_used_ += entry.data.size();
+  entries_.push_back(std::move(entry));
+
+  while (memory_used_ > memory_budget_bytes_) {
+    if (keyframe_count_ == 1) {
+      // Only the group being recorded is left; start a new keyframe so this one can be dropped next time
+      frames_since_keyframe_ = keyframe_interval_;
+      break;
+    }
+    evict_oldest_group();
+  }
+}
+
+bool RewindBuffer::pop(std::vector<uint8_t>& snapshot) {
+  if (entries_.empty()) {
+    return false;
+  }
+
+  Entry& entry = entries_.back();
+  const bool keyframe = entry.keyframe;
+  decode(entry.data, keyframe ? empty_reference_ : keyframe_, snapshot);
+  memory_used_ -= entry.data.size();
+  entries_.pop_back();
+
+  if (keyframe) {
+    keyframe_count_--;
+    reload_newest_keyframe();
+  } else {
+    frames_since_keyframe_--;
+  }
+  return true;
+}
+
+void RewindBuffer::clear() {
+  entries_.clear();
+  keyframe_.clear();
+  frames_since_keyframe_ = 0;
+  memory_used_ = 0;
+  keyframe_count_ = 0;
+}
+
+void RewindBuffer::evict_oldest_group() {
+  do {
+    memory_used_ -= entries_.front().data.size();
+    entries_.pop_front();
+  } while (!entries_.empty() && !entries_.front().keyframe);
+  keyframe_count_--;
+}
+
+void RewindBuffer::reload_newest_keyframe() {
+  frames_since_keyframe_ = 0;
+  for (auto it = entries_.rbegin(); it != entries_.rend(); ++it) {
+    frames_since_keyframe_++;
+    if (it->keyframe) {
+      decode(it->data, empty_reference_, keyframe_);
+      return;
+    }
+  }
+  keyframe_.clear();
+}
+
+// Encoded layout: varint snapshot size, then repeated (varint unchanged run, varint literal count, literal
+// bytes) where the literals are the snapshot XOR the reference. Bytes past the end of the reference are XORed
+// against zero.
+void RewindBuffer::encode(const std::vector<uint8_t>& snapshot, const std::vector<uint8_t>& reference,
+                          std::vector<uint8_t>& out) {
+  const size_t size = snapshot.size();
+  const size_t common = std::min(size, reference.size());
+  auto delta_at = [&](size_t i) -> uint8_t { return snapshot[i] ^ (i < common ? reference[i] : 0); };
+
+  out.clear();
+  write_varint(out, size);
+
+  size_t i = 0;
+  while (i < size) {
+    const size_t run_start = i;
+    while (i + sizeof(uint64_t) <= common && load_u64(&snapshot[i]) == load_u64(&reference[i])) {
+      i += sizeof(uint64_t);
+    }
+    while (i < size && delta_at(i) == 0) {
+      i++;
+    }
+    write_varint(out, i - run_start);
+
+    size_t literal_end = i;
+    while (literal_end < size) {
+      if (delta_at(literal_end) != 0) {
+        literal_end++;
+        continue;
+      }
+      size_t gap_end = literal_end;
+      while (gap_end < size && gap_end - literal_end < MIN_UNCHANGED_RUN && delta_at(gap_end) == 0) {
+        gap_end++;
+      }
+      if (gap_end == size || gap_end - literal_end == MIN_UNCHANGED_RUN) {
+        break;
+      }
+      literal_end = gap_end;
+    }
+
+    write_varint(out, literal_end - i);
+    for (; i < literal_end; i++) {
+      out.push_back(delta_at(i));
+    }
+  }
+}
+
+void RewindBuffer::decode(const std::vector<uint8_t>& encoded, const std::vector<uint8_t>& reference,
+                          std::vector<uint8_t>& out) {
+  size_t position = 0;
+  const size_t size = read_varint(encoded, position);
+  const size_t common = std::min(size, reference.size());
+
+  out.assign(reference.begin(), reference.begin() + common);
+  out.resize(size, 0);
+
+  size_t i = 0;
+  while (position < encoded.size()) {
+    i += read_varint(encoded, position);
+    size_t literal_count = read_varint(encoded, position);
+    for (; literal_count > 0 && i < size && position < encoded.size(); literal_count--) {
+      out[i++] ^= encoded[position++];
+    }
+  }
+}
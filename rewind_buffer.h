@@ -0,0 +1,46 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <deque>
+#include <vector>
+
+// Ring of in-memory save-state snapshots kept within a fixed memory budget.
+// Every keyframe_interval-th snapshot is stored as a keyframe; the ones in between are stored as an XOR delta
+// against that keyframe, run-length encoded so that unchanged bytes cost almost nothing. When the budget is
+// exceeded the oldest keyframe and its deltas are dropped together.
+class RewindBuffer {
+public:
+  RewindBuffer(size_t memory_budget_bytes, uint32_t keyframe_interval);
+
+  void push(const std::vector<uint8_t>& snapshot);
+  // Removes the newest snapshot and decodes it into snapshot. Returns false if the buffer is empty.
+  bool pop(std::vector<uint8_t>& snapshot);
+  void clear();
+
+  bool empty() const { return entries_.empty(); }
+  size_t size() const { return entries_.size(); }
+  size_t memory_used() const { return memory_used_; }
+
+private:
+  struct Entry {
+    bool keyframe;
+    std::vector<uint8_t> data;
+  };
+
+  static void encode(const std::vector<uint8_t>& snapshot, const std::vector<uint8_t>& reference,
+                     std::vector<uint8_t>& out);
+  static void decode(const std::vector<uint8_t>& encoded, const std::vector<uint8_t>& reference,
+                     std::vector<uint8_t>& out);
+  void evict_oldest_group();
+  void reload_newest_keyframe();
+
+  size_t memory_budget_bytes_;
+  uint32_t keyframe_interval_;
+  uint32_t frames_since_keyframe_ = 0;
+  size_t memory_used_ = 0;
+  size_t keyframe_count_ = 0;
+  std::deque<Entry> entries_;
+  std::vector<uint8_t> keyframe_;  // Decoded copy of the newest keyframe, the reference for new deltas
+  std::vector<uint8_t> empty_reference_;
+};
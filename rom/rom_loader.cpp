@@ -1,5 +1,6 @@
 #include "rom_loader.h"
 #include <algorithm>
+#include <cstring>
 #include <fstream>
 #include <iostream>
 #include "constants.h"
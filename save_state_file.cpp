@@ -0,0 +1,297 @@
+#include "save_state_file.h"
+#include <algorithm>
+#include <cstring>
+#include <fstream>
+#include <stdexcept>
+
+namespace {
+// ===== Section Compression =====
+// A small LZ77 variant in the style of LZ4: each sequence is a token (literal count in the high nibble, match
+// length - MIN_MATCH in the low nibble, 15 meaning "more bytes follow"), the literals, then a 16-bit match
+// offset. The final sequence has literals only. It trades ratio for speed; save states are mostly zero-filled
+// or repetitive memory so it still shrinks them considerably.
+constexpr size_t MIN_MATCH = 4;
+constexpr size_t MAX_OFFSET = 0xFFFF;
+constexpr uint32_t HASH_BITS = 14;
+constexpr uint8_t NIBBLE_MAX = 15;
+constexpr size_t MAX_EXPANSION = 256;  // A run of 0xFF length bytes adds 255 bytes of output per input byte
+
+uint32_t load_u32(const uint8_t* data) {
+  uint32_t value;
+  memcpy(&value, data, sizeof(value));
+  return value;
+}
+
+void write_length(std::vector<uint8_t>& out, size_t length) {
+  while (length >= 0xFF) {
+    out.push_back(0xFF);
+    length -= 0xFF;
+  }
+  out.push_back(static_cast<uint8_t>(length));
+}
+
+void write_sequence(std::vector<uint8_t>& out, const uint8_t* literals, size_t literal_count, size_t offset,
+                    size_t match_length) {
+  const size_t match_code = match_length ? match_length - MIN_MATCH : 0;
+  out.push_back(static_cast<uint8_t>(std::min<size_t>(literal_count, NIBBLE_MAX) << 4 |
+                                     std::min<size_t>(match_code, NIBBLE_MAX)));
+  if (literal_count >= NIBBLE_MAX) {
+    write_length(out, literal_count - NIBBLE_MAX);
+  }
+  out.insert(out.end(), literals, literals + literal_count);
+
+  if (match_length) {
+    out.push_back(static_cast<uint8_t>(offset));
+    out.push_back(static_cast<uint8_t>(offset >> 8));
+    if (match_code >= NIBBLE_MAX) {
+      write_length(out, match_code - NIBBLE_MAX);
+    }
+  }
+}
+
+void compress(std::span<const uint8_t> in, std::vector<uint8_t>& out) {
+  std::vector<int64_t> table(size_t{1} << HASH_BITS, -1);
+  const uint8_t* src = in.data();
+  const size_t size = in.size();
+
+  out.clear();
+  size_t anchor = 0;
+  size_t i = 0;
+  while (i + MIN_MATCH <= size) {
+    const uint32_t sequence = load_u32(src + i);
+    const uint32_t hash = (sequence * 2654435761u) >> (32 - HASH_BITS);
+    const int64_t candidate = table[hash];
+    table[hash] = static_cast<int64_t>(i);
+
+    if (candidate < 0 || i - candidate > MAX_OFFSET || load_u32(src + candidate) != sequence) {
+      i++;
+      continue;
+    }
+
+    size_t match_length = MIN_MATCH;
+    while (i + match_length < size && src[candidate + match_length] == src[i + match_length]) {
+      match_length++;
+    }
+    write_sequence(out, src + anchor, i - anchor, i - candidate, match_length);
+    i += match_length;
+    anchor = i;
+  }
+
+  if (anchor < size) {
+    write_sequence(out, src + anchor, size - anchor, 0, 0);
+  }
+}
+
+size_t read_length(std::span<const uint8_t> in, size_t& position) {
+  size_t length = 0;
+  uint8_t byte;
+  do {
+    if (position >= in.size()) {
+      throw std::runtime_error("Corrupt compressed save state section");
+    }
+    byte = in[position++];
+    length += byte;
+  } while (byte == 0xFF);
+  return length;
+}
+
+void decompress(std::span<const uint8_t> in, std::vector<uint8_t>& out, size_t raw_size) {
+  if (raw_size / MAX_EXPANSION > in.size()) {
+    throw std::runtime_error("Corrupt compressed save state section");
+  }
+  out.resize(raw_size);
+  size_t position = 0;
+  size_t written = 0;
+
+  while (position < in.size()) {
+    const uint8_t token = in[position++];
+
+    size_t literal_count = token >> 4;
+    if (literal_count == NIBBLE_MAX) {
+      literal_count += read_length(in, position);
+    }
+    if (literal_count > in.size() - position || literal_count > raw_size - written) {
+      throw std::runtime_error("Corrupt compressed save state section");
+    }
+    memcpy(out.data() + written, in.data() + position, literal_count);
+    position += literal_count;
+    written += literal_count;
+
+    if (position == in.size()) {
+      break;
+    }
+
+    if (in.size() - position < 2) {
+      throw std::runtime_error("Corrupt compressed save state section");
+    }
+    const size_t offset = in[position] | in[position + 1] << 8;
+    position += 2;
+    size_t match_length = (token & NIBBLE_MAX) + MIN_MATCH;
+    if ((token & NIBBLE_MAX) == NIBBLE_MAX) {
+      match_length += read_length(in, position);
+    }
+    if (offset == 0 || offset > written || match_length > raw_size - written) {
+      throw std::runtime_error("Corrupt compressed save state section");
+    }
+    // A match may overlap the bytes it produces (a repeating pattern with period offset). Copying from the
+    // start of the pattern in chunks no longer than the distance to it keeps every memcpy non-overlapping.
+    const size_t source = written - offset;
+    while (match_length > 0) {
+      const size_t count = std::min(match_length, written - source);
+      memcpy(out.data() + written, out.data() + source, count);
+      written += count;
+      match_length -= count;
+    }
+  }
+
+  if (written != raw_size) {
+    throw std::runtime_error("Corrupt compressed save state section");
+  }
+}
+}  // namespace
+
+std::string save_state_section_name(uint32_t tag) {
+  std::string name;
+  for (int i = 0; i < 4; i++) {
+    name += static_cast<char>(tag >> (i * 8));
+  }
+  return name;
+}
+
+void SaveStateWriter::append_section(SaveStateSection tag, uint32_t version) {
+  SaveStateSectionEntry entry = {};
+  entry.tag = static_cast<uint32_t>(tag);
+  entry.version = version;
+  entry.offset = payload_.size();
+  entry.raw_size = scratch_.size();
+
+  std::vector<uint8_t> compressed;
+  if (compress_) {
+    compress(scratch_, compressed);
+  }
+
+  if (compress_ && compressed.size() < scratch_.size()) {
+    entry.flags |= SECTION_FLAG_COMPRESSED;
+    entry.stored_size = compressed.size();
+    payload_.insert(payload_.end(), compressed.begin(), compressed.end());
+  } else {
+    entry.stored_size = scratch_.size();
+    payload_.insert(payload_.end(), scratch_.begin(), scratch_.end());
+  }
+  sections_.push_back(entry);
+}
+
+std::vector<uint8_t> SaveStateWriter::header_and_table() const {
+  SaveStateFileHeader header = {SAVE_STATE_MAGIC, SERIALIZER_VERSION, static_cast<uint32_t>(sections_.size()), 0};
+  const size_t payload_start = sizeof(header) + sections_.size() * sizeof(SaveStateSectionEntry);
+
+  std::vector<uint8_t> out(payload_start);
+  memcpy(out.data(), &header, sizeof(header));
+  for (size_t i = 0; i < sections_.size(); i++) {
+    SaveStateSectionEntry entry = sections_[i];
+    entry.offset += payload_start;
+    memcpy(out.data() + sizeof(header) + i * sizeof(entry), &entry, sizeof(entry));
+  }
+  return out;
+}
+
+void SaveStateWriter::write_to(std::vector<uint8_t>& out) const {
+  out = header_and_table();
+  out.insert(out.end(), payload_.begin(), payload_.end());
+}
+
+void SaveStateWriter::write_file(const std::string& path) const {
+  std::vector<uint8_t> header = header_and_table();
+
+  std::ofstream file(path, std::ios::binary);
+  if (!file.is_open()) {
+    throw std::runtime_error("Failed to open save state file: " + path);
+  }
+  file.write(reinterpret_cast<const char*>(header.data()), header.size());
+  file.write(reinterpret_cast<const char*>(payload_.data()), payload_.size());
+  if (!file.good()) {
+    throw std::runtime_error("Failed to write save state file: " + path);
+  }
+}
+
+SaveStateReader::SaveStateReader(const std::string& path) {
+  std::ifstream file(path, std::ios::binary | std::ios::ate);
+  if (!file.is_open()) {
+    throw std::runtime_error("Failed to open save state file: " + path);
+  }
+  file_data_.resize(static_cast<size_t>(file.tellg()));
+  file.seekg(0);
+  file.read(reinterpret_cast<char*>(file_data_.data()), file_data_.size());
+  data_ = file_data_;
+  parse();
+}
+
+SaveStateReader::SaveStateReader(std::span<const uint8_t> data) : data_(data) {
+  parse();
+}
+
+void SaveStateReader::parse() {
+  SaveStateFileHeader header;
+  if (data_.size() < sizeof(header)) {
+    throw std::runtime_error("Save state file is truncated");
+  }
+  memcpy(&header, data_.data(), sizeof(header));
+  if (header.magic != SAVE_STATE_MAGIC) {
+    throw std::runtime_error("Not a save state file, or saved by an older version");
+  }
+  if (header.version != SERIALIZER_VERSION) {
+    throw std::runtime_error("Save state version mismatch: " + std::to_string(header.version) +
+                             " != " + std::to_string(SERIALIZER_VERSION));
+  }
+
+  if (header.section_count > (data_.size() - sizeof(header)) / sizeof(SaveStateSectionEntry)) {
+    throw std::runtime_error("Save state section table is truncated");
+  }
+  sections_.resize(header.section_count);
+  memcpy(sections_.data(), data_.data() + sizeof(header), sections_.size() * sizeof(SaveStateSectionEntry));
+
+  for (const auto& entry : sections_) {
+    const std::string name = save_state_section_name(entry.tag);
+    if (entry.offset > data_.size() || entry.stored_size > data_.size() - entry.offset) {
+      throw std::runtime_error("Save state section " + name + " is truncated");
+    }
+    // Uncompressed payloads are used as they are, and no sequence expands to more than MAX_EXPANSION times its
+    // encoded size, so a raw size outside these bounds can only come from a corrupt table
+    const bool compressed = entry.flags & SECTION_FLAG_COMPRESSED;
+    if ((!compressed && entry.raw_size != entry.stored_size) ||
+        (compressed && entry.raw_size / MAX_EXPANSION > entry.stored_size)) {
+      throw std::runtime_error("Save state section " + name + " has an invalid size");
+    }
+  }
+}
+
+const SaveStateSectionEntry* SaveStateReader::find_section(SaveStateSection tag) const {
+  for (const auto& entry : sections_) {
+    if (entry.tag == static_cast<uint32_t>(tag)) {
+      return &entry;
+    }
+  }
+  return nullptr;
+}
+
+const SaveStateSectionEntry& SaveStateReader::require_section(SaveStateSection tag, uint32_t version) const {
+  const SaveStateSectionEntry* entry = find_section(tag);
+  const std::string name = save_state_section_name(static_cast<uint32_t>(tag));
+  if (!entry) {
+    throw std::runtime_error("Save state is missing section " + name);
+  }
+  if (entry->version == 0 || entry->version > version) {
+    throw std::runtime_error("Unsupported version " + std::to_string(entry->version) + " of save state section " +
+                             name + " (supports 1 to " + std::to_string(version) + ")");
+  }
+  return *entry;
+}
+
+std::span<const uint8_t> SaveStateReader::section_data(const SaveStateSectionEntry& entry) {
+  auto stored = data_.subspan(entry.offset, entry.stored_size);
+  if ((entry.flags & SECTION_FLAG_COMPRESSED) == 0) {
+    return stored;
+  }
+  decompress(stored, decompressed_, entry.raw_size);
+  return decompressed_;
+}
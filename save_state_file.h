@@ -0,0 +1,123 @@
+#pragma once
+
+#include <cstdint>
+#include <span>
+#include <string>
+#include <vector>
+#include "save_state.h"
+
+// ===== Save State File Layout =====
+// A save state file is a header, a table of section entries, then the section payloads. Each component is
+// serialized into its own section with its own version, so sections can be located, skipped or read on their
+// own (e.g. just VRAM from a memory-mapped file) without parsing the rest of the state.
+constexpr uint32_t save_state_tag(const char (&name)[5]) {
+  return static_cast<uint32_t>(name[0]) | static_cast<uint32_t>(name[1]) << 8 |
+         static_cast<uint32_t>(name[2]) << 16 | static_cast<uint32_t>(name[3]) << 24;
+}
+
+enum class SaveStateSection : uint32_t {
+  ROMInfo = save_state_tag("ROMI"),
+  CPU = save_state_tag("CPU "),
+  MemoryController = save_state_tag("MEMC"),
+  Timer = save_state_tag("TIMR"),
+  PPU = save_state_tag("PPU "),
+  PPUFifo = save_state_tag("PPUF"),  // The PPU built with GBEMU_FIFO_PPU, which saves renderer state as well
+  PPUMemory = save_state_tag("PPUM"),
+  APU = save_state_tag("APU "),
+  BootMemory = save_state_tag("MEMB"),  // MemoryController boot state, only in boot state cache entries
+};
+
+constexpr uint32_t SAVE_STATE_MAGIC = save_state_tag("GBSS");
+constexpr uint32_t SECTION_FLAG_COMPRESSED = 0x1;
+
+struct SaveStateFileHeader {
+  uint32_t magic;
+  uint32_t version;  // SERIALIZER_VERSION, the version of the container layout itself
+  uint32_t section_count;
+  uint32_t reserved;
+};
+
+struct SaveStateSectionEntry {
+  uint32_t tag;
+  uint32_t version;
+  uint32_t flags;
+  uint32_t reserved;
+  uint64_t offset;       // From the start of the file
+  uint64_t stored_size;  // Size of the payload in the file
+  uint64_t raw_size;     // Size of the payload once decompressed
+};
+
+class SaveStateWriter {
+public:
+  explicit SaveStateWriter(bool compress = true) : compress_(compress) {}
+
+  template <typename T>
+  void add_section(SaveStateSection tag, const T& component) {
+    add_section(tag, T::SAVE_STATE_VERSION, [&](SaveStateSerializer& serializer) { serializer << component; });
+  }
+
+  template <typename WriteFn>
+  void add_section(SaveStateSection tag, uint32_t version, WriteFn&& write) {
+    SaveStateSerializer serializer(scratch_, false, false);
+    write(serializer);
+    append_section(tag, version);
+  }
+
+  void write_to(std::vector<uint8_t>& out) const;
+  // Throws std::runtime_error if the file can't be written
+  void write_file(const std::string& path) const;
+
+private:
+  void append_section(SaveStateSection tag, uint32_t version);
+  std::vector<uint8_t> header_and_table() const;
+
+  bool compress_;
+  std::vector<uint8_t> scratch_;
+  std::vector<SaveStateSectionEntry> sections_;  // Offsets are relative to payload_ until written
+  std::vector<uint8_t> payload_;
+};
+
+// All methods throw std::runtime_error on malformed files, missing sections or unsupported versions.
+class SaveStateReader {
+public:
+  // Reads the whole file into memory
+  explicit SaveStateReader(const std::string& path);
+  // Reads from memory owned by the caller, e.g. a memory-mapped file, which must outlive the reader
+  explicit SaveStateReader(std::span<const uint8_t> data);
+
+  SaveStateReader(const SaveStateReader&) = delete;
+  SaveStateReader& operator=(const SaveStateReader&) = delete;
+
+  const std::vector<SaveStateSectionEntry>& sections() const { return sections_; }
+  const SaveStateSectionEntry* find_section(SaveStateSection tag) const;
+  // The section, if it's there in a version from 1 to version
+  const SaveStateSectionEntry& require_section(SaveStateSection tag, uint32_t version) const;
+
+  // The decompressed payload of a section. Uncompressed sections are a view straight into the file data;
+  // compressed ones are decompressed into storage that stays valid until the next call.
+  std::span<const uint8_t> section_data(const SaveStateSectionEntry& entry);
+
+  template <typename T>
+  void read_section(SaveStateSection tag, T& component) {
+    read_section(tag, T::SAVE_STATE_VERSION, [&](SaveStateSerializer& serializer) { serializer >> component; });
+  }
+
+  // Sections older than version are passed on with their version set, for the component to migrate
+  template <typename ReadFn>
+  void read_section(SaveStateSection tag, uint32_t version, ReadFn&& read) {
+    const SaveStateSectionEntry& entry = require_section(tag, version);
+    SaveStateSerializer serializer(section_data(entry), false);
+    serializer.set_section_version(entry.version);
+    read(serializer);
+  }
+
+private:
+  void parse();
+
+  std::vector<uint8_t> file_data_;
+  std::span<const uint8_t> data_;
+  std::vector<SaveStateSectionEntry> sections_;
+  std::vector<uint8_t> decompressed_;
+};
+
+std::string save_state_section_name(uint32_t tag);
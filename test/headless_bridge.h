@@ -0,0 +1,13 @@
+#pragma once
+
+#include "OSBridge.h"
+
+// A bridge that shows, plays and reads nothing, for tests that drive MainLoop themselves
+inline OSBridge headless_bridge() {
+  OSBridge bridge;
+  bridge.blit_screen = [](const uint32_t* pixels, size_t pitch) {};
+  bridge.present_frame = []() {};
+  bridge.handle_events = [](JoypadState& joypad_state) { return false; };
+  bridge.on_audio_generated = [](const int16_t* samples, int num_samples) {};
+  return bridge;
+}
@@ -68,6 +68,7 @@ int main(int argc, char** argv) {
   bridge.on_audio_generated = [](const int16_t* samples, int num_samples) {
   };
   MainLoop loop(loader, bridge);
+  loop.set_headless(true);
   std::string test_output;
   loop.cpu().mc().set_write_callback(std::bind(write_callback, std::ref(loop), std::placeholders::_1,
                                                std::placeholders::_2, std::ref(test_output)));
@@ -45,6 +45,7 @@ int main(int argc, char** argv) {
   };
 
   MainLoop loop(loader, bridge);
+  loop.set_headless(true);
 
   while (true) {
     loop.run_once();
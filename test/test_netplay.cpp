@@ -0,0 +1,141 @@
+#include <inttypes.h>
+#include <algorithm>
+#include <chrono>
+#include <iostream>
+#include <random>
+#include <vector>
+#include "headless_bridge.h"
+#include "main_loop.h"
+#include "netplay_session.h"
+#include "rom_loader.h"
+
+// Runs two rollback netplay peers in one process, talking UDP over 127.0.0.1 with latency, jitter and packet
+// loss injected on both sides. Every frame both peers confirm must hash the same on both peers and in a
+// reference run fed the final inputs directly, without any prediction or rollback.
+
+using namespace std::chrono;
+
+namespace {
+constexpr uint32_t HOST_FRAMES = 900;
+constexpr uint32_t INPUT_DELAY = 1;
+constexpr uint32_t LATENCY_FRAMES = 3;
+constexpr uint32_t JITTER_FRAMES = 2;
+constexpr double LOSS_RATE = 0.1;
+constexpr uint32_t INPUT_HOLD_FRAMES = 7;  // How long each player holds an input, so predictions often hit
+
+// Random but repeatable, and changing every INPUT_HOLD_FRAMES frames at a different time for each player
+uint8_t player_input_bits(uint32_t player, uint32_t frame) {
+  std::mt19937 random(player * 7919 + (frame + player * 3) / INPUT_HOLD_FRAMES);
+  return static_cast<uint8_t>(random());
+}
+
+JoypadState to_joypad_state(uint8_t bits) {
+  return {(bits & 0x01) != 0, (bits & 0x02) != 0, (bits & 0x04) != 0, (bits & 0x08) != 0,
+          (bits & 0x10) != 0, (bits & 0x20) != 0, (bits & 0x40) != 0, (bits & 0x80) != 0};
+}
+
+// The input a peer hands to advance_frame when it is about to emulate frame
+JoypadState player_input(uint32_t player, uint32_t frame) {
+  return to_joypad_state(player_input_bits(player, frame));
+}
+
+// What both players' input amounts to on frame, once delayed by INPUT_DELAY
+JoypadState combined_input(uint32_t frame) {
+  if (frame < INPUT_DELAY) {
+    return {};
+  }
+  return to_joypad_state(player_input_bits(0, frame - INPUT_DELAY) | player_input_bits(1, frame - INPUT_DELAY));
+}
+
+void print_stats(const char* name, const NetplayStats& stats) {
+  std::cout << name << ": " << stats.frames << " frames, " << stats.rollbacks << " rollbacks, "
+            << stats.resimulated_frames << " frames re-simulated ("
+            << static_cast<double>(stats.resimulated_frames) / stats.host_frames << " per host frame, max "
+            << stats.max_rollback_frames << " per rollback), " << stats.stalls << " stalls, "
+            << stats.packets_dropped << "/" << stats.packets_sent << " packets dropped" << std::endl;
+}
+}  // namespace
+
+int main(int argc, char** argv) {
+  if (argc < 2) {
+    std::cerr << "Usage: test_netplay Rom" << std::endl;
+    return -1;
+  }
+
+  // Separate loaders, so no cartridge state is shared between the machines
+  ROMLoader loader_a(argv[1]);
+  ROMLoader loader_b(argv[1]);
+  ROMLoader loader_reference(argv[1]);
+  if (!loader_a.load() || !loader_b.load() || !loader_reference.load()) {
+    return -1;
+  }
+
+  OSBridge bridge = headless_bridge();
+  MainLoop loop_a(loader_a, bridge);
+  MainLoop loop_b(loader_b, bridge);
+  MainLoop reference(loader_reference, bridge);
+  for (MainLoop* loop : {&loop_a, &loop_b, &reference}) {
+    loop->set_headless(true);
+  }
+
+  NetplaySession session_a(loop_a, *loader_a.header(), 0, INPUT_DELAY);
+  NetplaySession session_b(loop_b, *loader_b.header(), 0, INPUT_DELAY);
+  // The reference must start from the state both peers agreed on, or its hashes mean nothing
+  const uint64_t reference_key = NetplaySession::session_key(reference, *loader_reference.header());
+  if (session_a.session_key() != reference_key || session_b.session_key() != reference_key) {
+    std::cout << "Failed: session keys " << std::hex << session_a.session_key() << " and "
+              << session_b.session_key() << ", expected " << reference_key << std::endl;
+    return 1;
+  }
+  session_a.connect("127.0.0.1", session_b.local_port());
+  session_b.connect("127.0.0.1", session_a.local_port());
+  session_a.simulate_network(LATENCY_FRAMES, JITTER_FRAMES, LOSS_RATE, 1);
+  session_b.simulate_network(LATENCY_FRAMES, JITTER_FRAMES, LOSS_RATE, 2);
+
+  std::vector<uint64_t> hashes_a;
+  std::vector<uint64_t> hashes_b;
+  session_a.set_on_frame_confirmed([&](uint32_t frame, uint64_t hash) { hashes_a.push_back(hash); });
+  session_b.set_on_frame_confirmed([&](uint32_t frame, uint64_t hash) { hashes_b.push_back(hash); });
+
+  auto start_time = steady_clock::now();
+  for (uint32_t i = 0; i < HOST_FRAMES; i++) {
+    JoypadState input_a = player_input(0, session_a.frame());
+    session_a.advance_frame(input_a);
+    JoypadState input_b = player_input(1, session_b.frame());
+    session_b.advance_frame(input_b);
+  }
+  auto elapsed = duration<double>(steady_clock::now() - start_time).count();
+
+  const NetplayStats& stats_a = session_a.stats();
+  const NetplayStats& stats_b = session_b.stats();
+  print_stats("Peer A", stats_a);
+  print_stats("Peer B", stats_b);
+  const uint32_t emulated_frames = stats_a.frames + stats_a.resimulated_frames + stats_b.frames +
+                                   stats_b.resimulated_frames;
+  std::cout << "Re-simulation throughput: " << emulated_frames / elapsed << " frames per second across both peers ("
+            << 1000.0 * elapsed / (2 * HOST_FRAMES) << "ms per host frame)" << std::endl;
+
+  const size_t confirmed_frames = std::min(hashes_a.size(), hashes_b.size());
+  for (size_t frame = 0; frame < confirmed_frames; frame++) {
+    JoypadState input = combined_input(static_cast<uint32_t>(frame));
+    reference.emulate_frame(input);
+    const uint64_t expected = reference.state_hash();
+    if (hashes_a[frame] != expected || hashes_b[frame] != expected) {
+      std::cout << "Failed: frame " << frame << " hashes " << std::hex << hashes_a[frame] << " and "
+                << hashes_b[frame] << ", expected " << expected << std::endl;
+      return 1;
+    }
+  }
+  std::cout << confirmed_frames << " confirmed frames match" << std::endl;
+
+  if (confirmed_frames < HOST_FRAMES / 2) {
+    std::cout << "Failed: too few frames confirmed" << std::endl;
+    return 1;
+  }
+  if (stats_a.rollbacks == 0 || stats_b.rollbacks == 0) {
+    std::cout << "Failed: no rollbacks happened" << std::endl;
+    return 1;
+  }
+  std::cout << "Passed" << std::endl;
+  return 0;
+}
@@ -0,0 +1,79 @@
+#include <inttypes.h>
+#include <iostream>
+#include <vector>
+#include "headless_bridge.h"
+#include "main_loop.h"
+#include "rom_loader.h"
+
+// Records a snapshot every frame with rewind enabled, on a budget that only holds part of the run, then rewinds
+// through everything kept. Each rewind must land on the same state, hash for hash, as a run without rewind had at
+// that frame. The history left over spans several keyframes and the deltas between them, after whole groups have
+// been evicted from the front.
+
+namespace {
+constexpr uint32_t RECORDED_FRAMES = 300;
+constexpr uint32_t KEYFRAME_INTERVAL_FRAMES = 60;  // MainLoop's, at a snapshot every frame
+constexpr size_t REWIND_BUDGET_BYTES = 48 * 1024;
+
+void run_frame(MainLoop& loop) {
+  JoypadState input = {};
+  while (!loop.run(input)) {
+  }
+}
+}  // namespace
+
+int main(int argc, char** argv) {
+  if (argc < 2) {
+    std::cerr << "Usage: test_rewind Rom" << std::endl;
+    return -1;
+  }
+
+  ROMLoader loader_plain(argv[1]);
+  ROMLoader loader_rewind(argv[1]);
+  if (!loader_plain.load() || !loader_rewind.load()) {
+    return -1;
+  }
+
+  OSBridge bridge = headless_bridge();
+  MainLoop plain(loader_plain, bridge);
+  MainLoop rewinding(loader_rewind, bridge);
+  plain.set_headless(true);
+  rewinding.set_headless(true);
+  rewinding.enable_rewind(REWIND_BUDGET_BYTES, 1);
+
+  // expected[frame] is the state once that frame has finished. One more than is recorded, as rewinding to a
+  // snapshot runs it on to the end of the following frame.
+  std::vector<uint64_t> expected;
+  for (uint32_t frame = 0; frame <= RECORDED_FRAMES; frame++) {
+    run_frame(plain);
+    expected.push_back(plain.state_hash(StateHashMode::Full));
+    if (frame < RECORDED_FRAMES) {
+      run_frame(rewinding);
+    }
+  }
+
+  uint32_t rewound = 0;
+  while (rewinding.rewind()) {
+    rewound++;
+    // The snapshot taken at the end of frame RECORDED_FRAMES - rewound, run on through the next one
+    const uint32_t frame = RECORDED_FRAMES - rewound + 1;
+    const uint64_t actual = rewinding.state_hash(StateHashMode::Full);
+    if (actual != expected[frame]) {
+      std::cout << "Failed: rewind " << rewound << " hashes " << std::hex << actual << ", expected " << expected[frame]
+                << " from frame " << std::dec << frame << std::endl;
+      return 1;
+    }
+  }
+
+  if (rewound >= RECORDED_FRAMES) {
+    std::cout << "Failed: all " << rewound << " snapshots kept, so nothing was evicted" << std::endl;
+    return 1;
+  }
+  if (rewound <= 2 * KEYFRAME_INTERVAL_FRAMES) {
+    std::cout << "Failed: only " << rewound << " snapshots kept, too few to span a whole group" << std::endl;
+    return 1;
+  }
+
+  std::cout << "Passed: " << rewound << " of " << RECORDED_FRAMES << " frames rewound" << std::endl;
+  return 0;
+}
@@ -0,0 +1,72 @@
+#include <inttypes.h>
+#include <iostream>
+#include <string>
+#include "headless_bridge.h"
+#include "main_loop.h"
+#include "rom_loader.h"
+
+// Runs the same ROM twice, once with run-ahead and once without, and checks the real timeline of both hashes
+// the same every frame. Run with a boot ROM, it covers restoring snapshots taken before and after the boot ROM
+// unmaps itself.
+
+namespace {
+constexpr uint32_t RUN_AHEAD_FRAMES = 2;
+constexpr uint32_t MAX_BOOT_FRAMES = 600;  // The DMG boot ROM takes a few seconds to hand over
+constexpr uint32_t FRAMES_AFTER_BOOT = 60;
+
+void run_frame(MainLoop& loop) {
+  JoypadState input = {};
+  while (!loop.run(input)) {
+  }
+}
+}  // namespace
+
+int main(int argc, char** argv) {
+  if (argc < 2) {
+    std::cerr << "Usage: test_run_ahead Rom [BootRom]" << std::endl;
+    return -1;
+  }
+  const std::string boot_rom_filename = argc > 2 ? argv[2] : "";
+
+  // Separate loaders, so no cartridge state is shared between the machines
+  ROMLoader loader_plain(argv[1], boot_rom_filename);
+  ROMLoader loader_run_ahead(argv[1], boot_rom_filename);
+  if (!loader_plain.load() || !loader_run_ahead.load()) {
+    return -1;
+  }
+
+  OSBridge bridge = headless_bridge();
+  MainLoop plain(loader_plain, bridge);
+  MainLoop run_ahead(loader_run_ahead, bridge);
+  plain.set_headless(true);
+  run_ahead.set_headless(true);
+  run_ahead.set_run_ahead(RUN_AHEAD_FRAMES);
+
+  uint32_t frames_left = FRAMES_AFTER_BOOT;
+  for (uint32_t frame = 0; frames_left > 0; frame++) {
+    run_frame(plain);
+    run_frame(run_ahead);
+
+    if (plain.cpu().mc().boot_rom_active() != run_ahead.cpu().mc().boot_rom_active()) {
+      std::cout << "Failed: frame " << frame << " boot ROM mapped in only one run" << std::endl;
+      return 1;
+    }
+    const uint64_t expected = plain.state_hash(StateHashMode::Full);
+    const uint64_t actual = run_ahead.state_hash(StateHashMode::Full);
+    if (actual != expected) {
+      std::cout << "Failed: frame " << frame << " hashes " << std::hex << actual << ", expected " << expected
+                << std::endl;
+      return 1;
+    }
+
+    if (!plain.cpu().mc().boot_rom_active()) {
+      frames_left--;
+    } else if (frame == MAX_BOOT_FRAMES) {
+      std::cout << "Failed: boot ROM still mapped after " << frame << " frames" << std::endl;
+      return 1;
+    }
+  }
+
+  std::cout << "Passed" << std::endl;
+  return 0;
+}
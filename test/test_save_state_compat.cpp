@@ -0,0 +1,172 @@
+#include <inttypes.h>
+#include <fstream>
+#include <iostream>
+#include <iterator>
+#include <new>
+#include <stdexcept>
+#include <string>
+#include <vector>
+#include "headless_bridge.h"
+#include "main_loop.h"
+#include "rom_loader.h"
+#include "save_state_file.h"
+
+// Loads save states written by older builds, each with some sections in an older layout, into a fresh machine
+// and runs the test ROM they were saved from on to its result, which has to be a pass. Version 1 APU sections
+// only hold the registers, so the states were saved early, before the ROM gets to its timing-sensitive checks.
+//
+// The first state, and the same state resaved uncompressed, are then truncated and corrupted. Truncated ones
+// have to be refused with std::runtime_error. Corrupt ones may load, but anything else they throw, a bad_alloc
+// from a count read off the file included, fails the test, as does a refused state leaving the machine changed.
+
+namespace {
+constexpr uint32_t MAX_FRAMES = 60 * 30;       // dmg_sound singles finish within a few seconds
+constexpr uint32_t CORRUPTED_OFFSETS = 512;    // Spread evenly over the file
+constexpr uint8_t RESULT_RUNNING = 0x80;       // Blargg's result byte at 0xA000 until the test finishes
+constexpr uint16_t RESULT_ADDRESS = 0xA000;
+
+std::vector<uint8_t> read_file(const std::string& path) {
+  std::ifstream file(path, std::ios::binary);
+  return std::vector<uint8_t>(std::istreambuf_iterator<char>(file), std::istreambuf_iterator<char>());
+}
+
+bool load_and_pass(const std::string& rom, const std::string& state_path) {
+  ROMLoader loader(rom);
+  if (!loader.load()) {
+    return false;
+  }
+  OSBridge bridge = headless_bridge();
+  MainLoop loop(loader, bridge);
+  loop.set_headless(true);
+
+  SaveStateReader reader(state_path);
+  std::cout << state_path << ":";
+  for (const SaveStateSectionEntry& entry : reader.sections()) {
+    const char tag[] = {static_cast<char>(entry.tag), static_cast<char>(entry.tag >> 8),
+                        static_cast<char>(entry.tag >> 16), static_cast<char>(entry.tag >> 24), 0};
+    std::cout << " " << tag << " v" << entry.version;
+  }
+  std::cout << std::endl;
+  loop.load_sections(reader);
+
+  int result = -1;
+  loop.cpu().mc().set_write_callback([&](uint16_t address, uint8_t value) {
+    if (address == RESULT_ADDRESS && value != RESULT_RUNNING) {
+      result = value;
+    }
+  });
+  JoypadState input = {};
+  for (uint32_t frame = 0; frame < MAX_FRAMES && result < 0; frame++) {
+    loop.emulate_frame(input);
+  }
+  if (result != 0) {
+    std::cout << "Failed: " << state_path << " finished with result " << result << std::endl;
+    return false;
+  }
+  return true;
+}
+
+enum class LoadResult { Loaded, Refused, Crashed };
+
+// Loading has to either work or throw std::runtime_error, and a refused state must leave the machine untouched
+LoadResult try_load(const std::string& rom, std::span<const uint8_t> data) {
+  ROMLoader loader(rom);
+  if (!loader.load()) {
+    return LoadResult::Crashed;
+  }
+  OSBridge bridge = headless_bridge();
+  MainLoop loop(loader, bridge);
+  const uint64_t before = loop.state_hash(StateHashMode::Full);
+  try {
+    SaveStateReader reader(data);
+    loop.load_sections(reader);
+  } catch (const std::runtime_error& e) {
+    if (loop.state_hash(StateHashMode::Full) != before) {
+      std::cout << "Refused but partly loaded: " << e.what() << std::endl;
+      return LoadResult::Crashed;
+    }
+    return LoadResult::Refused;
+  } catch (const std::exception& e) {
+    std::cout << e.what() << std::endl;
+    return LoadResult::Crashed;
+  }
+  return LoadResult::Loaded;
+}
+
+// The state as the current build writes it, uncompressed so corruption reaches the components' own data
+std::vector<uint8_t> resave_uncompressed(const std::string& rom, std::span<const uint8_t> state) {
+  ROMLoader loader(rom);
+  loader.load();
+  OSBridge bridge = headless_bridge();
+  MainLoop loop(loader, bridge);
+  SaveStateReader reader(state);
+  loop.load_sections(reader);
+  SaveStateWriter writer(false);
+  loop.save_sections(writer);
+  std::vector<uint8_t> out;
+  writer.write_to(out);
+  return out;
+}
+
+bool corrupt_states_fail(const std::string& rom, const std::vector<uint8_t>& state, const char* name) {
+  for (size_t size : {size_t{0}, size_t{8}, state.size() / 2, state.size() - 1}) {
+    const std::vector<uint8_t> truncated(state.begin(), state.begin() + size);
+    if (try_load(rom, truncated) != LoadResult::Refused) {
+      std::cout << "Failed: " << name << " truncated to " << size << " bytes wasn't refused" << std::endl;
+      return false;
+    }
+  }
+
+  // Counts, sizes and offsets turned huge, wherever they are
+  for (uint32_t i = 0; i < CORRUPTED_OFFSETS; i++) {
+    const size_t offset = state.size() * i / CORRUPTED_OFFSETS;
+    std::vector<uint8_t> corrupted = state;
+    for (size_t byte = offset; byte < std::min(offset + 4, corrupted.size()); byte++) {
+      corrupted[byte] = 0xFF;
+    }
+    if (try_load(rom, corrupted) == LoadResult::Crashed) {
+      std::cout << "Failed: " << name << " with bytes " << offset << " on set to 0xFF" << std::endl;
+      return false;
+    }
+  }
+  return true;
+}
+
+// A vector count far beyond the data has to be refused before the vector is sized for it
+bool huge_vector_count_fails() {
+  const std::vector<uint8_t> huge_count = {0xFF, 0xFF, 0xFF, 0xFF};
+  try {
+    SaveStateSerializer serializer(std::span<const uint8_t>(huge_count), false);
+    std::vector<uint64_t> values;
+    serializer >> values;
+  } catch (const std::runtime_error&) {
+    return true;
+  } catch (const std::bad_alloc&) {
+  }
+  std::cout << "Failed: vector sized from a corrupt count" << std::endl;
+  return false;
+}
+}  // namespace
+
+int main(int argc, char** argv) {
+  if (argc < 3) {
+    std::cerr << "Usage: test_save_state_compat Rom State..." << std::endl;
+    return -1;
+  }
+  const std::string rom = argv[1];
+
+  for (int i = 2; i < argc; i++) {
+    if (!load_and_pass(rom, argv[i])) {
+      return 1;
+    }
+  }
+  const std::vector<uint8_t> old_state = read_file(argv[2]);
+  if (!corrupt_states_fail(rom, old_state, argv[2]) ||
+      !corrupt_states_fail(rom, resave_uncompressed(rom, old_state), "Uncompressed resave") ||
+      !huge_vector_count_fails()) {
+    return 1;
+  }
+
+  std::cout << "Passed" << std::endl;
+  return 0;
+}
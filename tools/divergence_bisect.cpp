@@ -0,0 +1,380 @@
+#include <inttypes.h>
+#include <cstdio>
+#include <filesystem>
+#include <iomanip>
+#include <iostream>
+#include <optional>
+#include <sstream>
+#include <string>
+#include <vector>
+#include "main_loop.h"
+#include "rom_loader.h"
+#include "save_state_file.h"
+
+#ifdef _WIN32
+#define popen _popen
+#define pclose _pclose
+constexpr const char* NULL_DEVICE = "NUL";
+#else
+constexpr const char* NULL_DEVICE = "/dev/null";
+#endif
+
+// Finds the first instruction where two builds of the core diverge on the same ROM.
+//
+// Both builds run headless and report a state hash every `interval` instructions. Between the last matching
+// and the first mismatching checkpoint, both are restarted from a snapshot of the matching checkpoint and
+// bisected down to a single instruction, then the two states are diffed. The other build is driven through
+// the same subcommands of its own copy of this tool, so snapshots must be loadable by both builds.
+//
+//   divergence_bisect bisect <rom> <other divergence_bisect> <interval> <checkpoints>
+//   divergence_bisect trace <rom> <interval> <checkpoints>       Hash at every checkpoint, one per line
+//   divergence_bisect step <rom> <state or -> <instructions> [out state]
+//   divergence_bisect diff <rom> <state a> <state b>
+
+namespace {
+// ===== Divergence Bisect Constants =====
+constexpr size_t MAX_DIFF_LINES = 32;  // Per category, so one runaway difference doesn't bury the rest
+
+struct MemoryRange {
+  uint16_t start;
+  uint16_t end;
+};
+// Everything mapped above the ROM: VRAM, cart RAM, WRAM, OAM, I/O and HRAM
+constexpr MemoryRange DIFF_RANGES[] = {{0x8000, 0xDFFF}, {0xFE00, 0xFE9F}, {0xFF00, 0xFFFF}};
+
+class HeadlessCore {
+public:
+  explicit HeadlessCore(const std::string& rom) : loader_(rom) {
+    if (!loader_.load()) {
+      throw std::runtime_error("Failed to load ROM: " + rom);
+    }
+    OSBridge bridge;
+    bridge.on_audio_generated = [](const int16_t*, int) {};
+    bridge.present_frame = []() {};
+    bridge.handle_events = [](JoypadState&) { return false; };
+    bridge.blit_screen = [](const uint32_t*, size_t) {};
+    loop_.emplace(loader_, bridge);
+    loop_->set_headless(true);
+  }
+
+  MainLoop& loop() { return *loop_; }
+
+  void load(const std::string& path) {
+    SaveStateReader reader(path);
+    loop_->load_sections(reader);
+  }
+
+  void save(const std::string& path) const {
+    SaveStateWriter writer;
+    loop_->save_sections(writer);
+    writer.write_file(path);
+  }
+
+  void run(uint64_t instructions) {
+    for (uint64_t i = 0; i < instructions; i++) {
+      loop_->run_once();
+    }
+  }
+
+  std::string hash() { return hex(loop_->state_hash(StateHashMode::Full)); }
+
+  static std::string hex(uint64_t value) {
+    std::ostringstream out;
+    out << std::hex << std::setw(16) << std::setfill('0') << value;
+    return out.str();
+  }
+
+private:
+  ROMLoader loader_;
+  std::optional<MainLoop> loop_;
+};
+
+#ifdef _WIN32
+// For the C runtime's command line splitting: double quotes group an argument, and backslashes are only escapes
+// in front of a double quote
+std::string quote(const std::string& arg) {
+  std::string quoted = "\"";
+  size_t backslashes = 0;
+  for (char ch : arg) {
+    if (ch == '\\') {
+      backslashes++;
+      continue;
+    }
+    quoted.append(ch == '"' ? backslashes * 2 + 1 : backslashes, '\\');
+    quoted += ch;
+    backslashes = 0;
+  }
+  quoted.append(backslashes * 2, '\\');
+  return quoted + "\"";
+}
+#else
+std::string quote(const std::string& arg) {
+  std::string quoted = "'";
+  for (char ch : arg) {
+    quoted += ch == '\'' ? std::string("'\\''") : std::string(1, ch);
+  }
+  return quoted + "'";
+}
+#endif
+
+// Runs a subcommand of a divergence_bisect binary and returns its stdout split into lines
+std::vector<std::string> run_tool(const std::string& tool, const std::vector<std::string>& args) {
+  std::string command = quote(tool);
+  for (const auto& arg : args) {
+    command += ' ';
+    command += quote(arg);
+  }
+  command += std::string(" 2>") + NULL_DEVICE;
+#ifdef _WIN32
+  // cmd /c drops the first and last quote of a command that starts with one
+  command = '"' + command + '"';
+#endif
+
+  FILE* pipe = popen(command.c_str(), "r");
+  if (!pipe) {
+    throw std::runtime_error("Failed to run " + command);
+  }
+  std::vector<std::string> lines;
+  std::string line;
+  for (int ch; (ch = fgetc(pipe)) != EOF;) {
+    if (ch == '\n') {
+      lines.push_back(line);
+      line.clear();
+    } else {
+      line += static_cast<char>(ch);
+    }
+  }
+  if (pclose(pipe) != 0) {
+    throw std::runtime_error("Command failed: " + command);
+  }
+  return lines;
+}
+
+// The last line a step prints is the state hash
+std::string step_hash(const std::string& tool, const std::string& rom, const std::string& state,
+                      uint64_t instructions, const std::string& out = "") {
+  std::vector<std::string> args = {"step", rom, state, std::to_string(instructions)};
+  if (!out.empty()) {
+    args.push_back(out);
+  }
+  auto lines = run_tool(tool, args);
+  if (lines.empty()) {
+    throw std::runtime_error("No hash from " + tool);
+  }
+  return lines.back();
+}
+
+template <typename T>
+void print_difference(const std::string& name, T a, T b) {
+  std::cout << "  " << name << ": " << std::hex << std::setfill('0') << std::setw(sizeof(T) * 2) << +a << " vs "
+            << std::setw(sizeof(T) * 2) << +b << std::dec << std::endl;
+}
+
+void diff_registers(MainLoop& a, MainLoop& b) {
+  auto& ra = a.cpu().registers();
+  auto& rb = b.cpu().registers();
+  const std::pair<const char*, std::pair<uint16_t, uint16_t>> registers[] = {
+      {"PC", {ra.pc().get(), rb.pc().get()}}, {"SP", {ra.SP().get(), rb.SP().get()}},
+      {"AF", {ra.AF().get(), rb.AF().get()}}, {"BC", {ra.BC().get(), rb.BC().get()}},
+      {"DE", {ra.DE().get(), rb.DE().get()}}, {"HL", {ra.HL().get(), rb.HL().get()}},
+  };
+
+  std::cout << "CPU registers:" << std::endl;
+  for (const auto& [name, values] : registers) {
+    if (values.first != values.second) {
+      print_difference(name, values.first, values.second);
+    }
+  }
+}
+
+void diff_memory(MainLoop& a, MainLoop& b) {
+  std::cout << "Memory:" << std::endl;
+  size_t count = 0;
+  for (const auto& range : DIFF_RANGES) {
+    for (uint32_t addr = range.start; addr <= range.end; addr++) {
+      const uint8_t* va = a.cpu().memory_bridge().read(addr);
+      const uint8_t* vb = b.cpu().memory_bridge().read(addr);
+      if (!va || !vb || *va == *vb) {
+        continue;
+      }
+      if (count++ < MAX_DIFF_LINES) {
+        std::ostringstream name;
+        name << std::hex << std::setw(4) << std::setfill('0') << addr;
+        print_difference(name.str(), *va, *vb);
+      }
+    }
+  }
+  if (count > MAX_DIFF_LINES) {
+    std::cout << "  ... " << count - MAX_DIFF_LINES << " more" << std::endl;
+  }
+}
+
+// Catches internal state (PPU/APU/timer counters, other cart RAM banks) that isn't visible on the bus
+void diff_sections(const std::string& path_a, const std::string& path_b) {
+  SaveStateReader a(path_a);
+  SaveStateReader b(path_b);
+  std::cout << "Save state sections:" << std::endl;
+  for (const auto& entry : a.sections()) {
+    const std::string name = save_state_section_name(entry.tag);
+    const auto* other = b.find_section(static_cast<SaveStateSection>(entry.tag));
+    if (!other) {
+      std::cout << "  " << name << ": missing from second state" << std::endl;
+      continue;
+    }
+    auto data_a = a.section_data(entry);
+    std::vector<uint8_t> bytes_a(data_a.begin(), data_a.end());
+    auto bytes_b = b.section_data(*other);
+    if (bytes_a.size() != bytes_b.size()) {
+      std::cout << "  " << name << ": " << bytes_a.size() << " vs " << bytes_b.size() << " bytes" << std::endl;
+      continue;
+    }
+
+    size_t count = 0;
+    for (size_t i = 0; i < bytes_a.size(); i++) {
+      if (bytes_a[i] != bytes_b[i] && count++ < MAX_DIFF_LINES) {
+        print_difference(name + "+" + std::to_string(i), bytes_a[i], bytes_b[i]);
+      }
+    }
+    if (count > MAX_DIFF_LINES) {
+      std::cout << "  ... " << count - MAX_DIFF_LINES << " more in " << name << std::endl;
+    }
+  }
+}
+
+int diff(const std::string& rom, const std::string& path_a, const std::string& path_b) {
+  HeadlessCore a(rom);
+  HeadlessCore b(rom);
+  a.load(path_a);
+  b.load(path_b);
+  diff_registers(a.loop(), b.loop());
+  diff_memory(a.loop(), b.loop());
+  diff_sections(path_a, path_b);
+  return 0;
+}
+
+// trace and step print their hashes to results, as std::cout carries the core's log output
+int trace(const std::string& rom, uint64_t interval, uint64_t checkpoints, std::ostream& results) {
+  HeadlessCore core(rom);
+  results << core.hash() << std::endl;
+  for (uint64_t i = 0; i < checkpoints; i++) {
+    core.run(interval);
+    results << core.hash() << std::endl;
+  }
+  return 0;
+}
+
+int step(const std::string& rom, const std::string& state, uint64_t instructions, const std::string& out,
+         std::ostream& results) {
+  HeadlessCore core(rom);
+  if (state != "-") {
+    core.load(state);
+  }
+  core.run(instructions);
+  if (!out.empty()) {
+    core.save(out);
+  }
+  results << core.hash() << std::endl;
+  return 0;
+}
+
+int bisect(const std::string& self, const std::string& rom, const std::string& other, uint64_t interval,
+           uint64_t checkpoints) {
+  const std::vector<std::string> trace_args = {"trace", rom, std::to_string(interval), std::to_string(checkpoints)};
+  auto trace_a = run_tool(self, trace_args);
+  auto trace_b = run_tool(other, trace_args);
+
+  size_t checkpoint = 0;
+  while (checkpoint < trace_a.size() && checkpoint < trace_b.size() && trace_a[checkpoint] == trace_b[checkpoint]) {
+    checkpoint++;
+  }
+  if (checkpoint == trace_a.size() && checkpoint == trace_b.size()) {
+    std::cout << "No divergence in " << interval * checkpoints << " instructions" << std::endl;
+    return 0;
+  }
+
+  const auto temp = std::filesystem::temp_directory_path();
+  const std::string start_state = (temp / "divergence_start.state").string();
+  const std::string state_a = (temp / "divergence_a.state").string();
+  const std::string state_b = (temp / "divergence_b.state").string();
+
+  // Bisect the instructions after the last matching checkpoint. This assumes that once the states differ they
+  // stay different; if they briefly converge again, the result is still a point where they diverge.
+  uint64_t matching = 0;
+  uint64_t differing = 0;
+  if (checkpoint > 0) {
+    step_hash(self, rom, "-", (checkpoint - 1) * interval, start_state);
+    differing = interval;
+    while (differing - matching > 1) {
+      const uint64_t middle = matching + (differing - matching) / 2;
+      if (step_hash(self, rom, start_state, middle) == step_hash(other, rom, start_state, middle)) {
+        matching = middle;
+      } else {
+        differing = middle;
+      }
+    }
+  } else {
+    step_hash(self, rom, "-", 0, start_state);
+  }
+
+  step_hash(self, rom, start_state, differing, state_a);
+  step_hash(other, rom, start_state, differing, state_b);
+
+  const uint64_t instruction = checkpoint > 0 ? (checkpoint - 1) * interval + differing : 0;
+  if (instruction == 0) {
+    std::cout << "States differ at power on" << std::endl;
+  } else {
+    HeadlessCore before(rom);
+    before.load(start_state);
+    before.run(matching);
+    std::cout << "States first differ after instruction " << instruction << " (PC " << std::hex << std::setw(4)
+              << std::setfill('0') << before.loop().cpu().registers().pc().get() << std::dec << ")" << std::endl;
+  }
+  std::cout << "This build vs " << other << ":" << std::endl;
+  diff(rom, state_a, state_b);
+  return 1;
+}
+
+void usage() {
+  std::cerr << "Usage:" << std::endl
+            << "  divergence_bisect bisect <rom> <other divergence_bisect> <interval> <checkpoints>" << std::endl
+            << "  divergence_bisect trace <rom> <interval> <checkpoints>" << std::endl
+            << "  divergence_bisect step <rom> <state or -> <instructions> [out state]" << std::endl
+            << "  divergence_bisect diff <rom> <state a> <state b>" << std::endl;
+}
+}  // namespace
+
+int main(int argc, char** argv) {
+  std::vector<std::string> args(argv + 1, argv + argc);
+  if (args.size() < 2) {
+    usage();
+    return -1;
+  }
+
+  // The core logs to stdout, so the hashes the driver parses go to a stream of their own
+  std::ostream results(std::cout.rdbuf());
+  std::ostringstream log;
+
+  try {
+    if (args[0] == "bisect" && args.size() == 5) {
+      return bisect(std::filesystem::absolute(argv[0]).string(), args[1], args[2], std::stoull(args[3]),
+                    std::stoull(args[4]));
+    }
+    if (args[0] == "diff" && args.size() == 4) {
+      return diff(args[1], args[2], args[3]);
+    }
+    if (args[0] == "trace" && args.size() == 4) {
+      std::cout.rdbuf(log.rdbuf());
+      return trace(args[1], std::stoull(args[2]), std::stoull(args[3]), results);
+    }
+    if (args[0] == "step" && (args.size() == 4 || args.size() == 5)) {
+      std::cout.rdbuf(log.rdbuf());
+      return step(args[1], args[2], std::stoull(args[3]), args.size() == 5 ? args[4] : "", results);
+    }
+  } catch (const std::exception& e) {
+    std::cerr << e.what() << std::endl;
+    return -1;
+  }
+
+  usage();
+  return -1;
+}
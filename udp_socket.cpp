@@ -0,0 +1,140 @@
+#include "udp_socket.h"
+#include <cstring>
+#include <stdexcept>
+
+#ifdef _WIN32
+#include <winsock2.h>
+#include <ws2tcpip.h>
+#else
+#include <arpa/inet.h>
+#include <fcntl.h>
+#include <netdb.h>
+#include <netinet/in.h>
+#include <sys/socket.h>
+#include <unistd.h>
+#endif
+
+// ===== UDP Socket Platform Helpers =====
+namespace {
+#ifdef _WIN32
+using NativeSocket = SOCKET;
+using SocketLength = int;
+
+void close_socket(NativeSocket socket) {
+  closesocket(socket);
+}
+
+bool set_non_blocking(NativeSocket socket) {
+  u_long non_blocking = 1;
+  return ioctlsocket(socket, FIONBIO, &non_blocking) == 0;
+}
+#else
+using NativeSocket = int;
+using SocketLength = socklen_t;
+
+void close_socket(NativeSocket socket) {
+  ::close(socket);
+}
+
+bool set_non_blocking(NativeSocket socket) {
+  const int flags = fcntl(socket, F_GETFL, 0);
+  return flags >= 0 && fcntl(socket, F_SETFL, flags | O_NONBLOCK) == 0;
+}
+#endif
+
+NativeSocket native(intptr_t socket) {
+  return static_cast<NativeSocket>(socket);
+}
+}  // namespace
+
+UdpSocket::UdpSocket(uint16_t local_port) {
+#ifdef _WIN32
+  // Winsock counts startups, so every socket can start and clean up its own
+  WSADATA wsa_data;
+  if (WSAStartup(MAKEWORD(2, 2), &wsa_data) != 0) {
+    throw std::runtime_error("UdpSocket: Failed to initialise Winsock");
+  }
+#endif
+
+  NativeSocket socket = ::socket(AF_INET, SOCK_DGRAM, IPPROTO_UDP);
+  socket_ = static_cast<intptr_t>(socket);
+  if (socket_ == -1) {
+    close();
+    throw std::runtime_error("UdpSocket: Failed to create socket");
+  }
+
+  sockaddr_in address = {};
+  address.sin_family = AF_INET;
+  address.sin_addr.s_addr = htonl(INADDR_ANY);
+  address.sin_port = htons(local_port);
+  if (bind(socket, reinterpret_cast<const sockaddr*>(&address), sizeof(address)) != 0 ||
+      !set_non_blocking(socket)) {
+    close();
+    throw std::runtime_error("UdpSocket: Failed to bind port " + std::to_string(local_port));
+  }
+}
+
+UdpSocket::~UdpSocket() {
+  close();
+}
+
+void UdpSocket::close() {
+  if (socket_ != -1) {
+    close_socket(native(socket_));
+    socket_ = -1;
+  }
+#ifdef _WIN32
+  WSACleanup();
+#endif
+}
+
+uint16_t UdpSocket::local_port() const {
+  sockaddr_in address = {};
+  SocketLength length = sizeof(address);
+  if (getsockname(native(socket_), reinterpret_cast<sockaddr*>(&address), &length) != 0) {
+    return 0;
+  }
+  return ntohs(address.sin_port);
+}
+
+void UdpSocket::connect(const std::string& host, uint16_t port) {
+  addrinfo hints = {};
+  hints.ai_family = AF_INET;
+  hints.ai_socktype = SOCK_DGRAM;
+  addrinfo* result = nullptr;
+  if (getaddrinfo(host.c_str(), nullptr, &hints, &result) != 0 || !result) {
+    throw std::runtime_error("UdpSocket: Failed to resolve " + host);
+  }
+
+  peer_address_ = reinterpret_cast<const sockaddr_in*>(result->ai_addr)->sin_addr.s_addr;
+  peer_port_ = htons(port);
+  connected_ = true;
+  freeaddrinfo(result);
+}
+
+void UdpSocket::send(std::span<const uint8_t> data) {
+  if (!connected_) {
+    return;
+  }
+  sockaddr_in address = {};
+  address.sin_family = AF_INET;
+  address.sin_addr.s_addr = peer_address_;
+  address.sin_port = peer_port_;
+  sendto(native(socket_), reinterpret_cast<const char*>(data.data()), static_cast<int>(data.size()), 0,
+         reinterpret_cast<const sockaddr*>(&address), sizeof(address));
+}
+
+size_t UdpSocket::receive(std::span<uint8_t> buffer) {
+  while (true) {
+    sockaddr_in address = {};
+    SocketLength length = sizeof(address);
+    const auto size = recvfrom(native(socket_), reinterpret_cast<char*>(buffer.data()),
+                               static_cast<int>(buffer.size()), 0, reinterpret_cast<sockaddr*>(&address), &length);
+    if (size <= 0) {
+      return 0;
+    }
+    if (connected_ && address.sin_addr.s_addr == peer_address_ && address.sin_port == peer_port_) {
+      return static_cast<size_t>(size);
+    }
+  }
+}
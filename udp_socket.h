@@ -0,0 +1,36 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <span>
+#include <string>
+
+// Non-blocking UDP socket talking to a single peer. Setup errors throw std::runtime_error; errors sending or
+// receiving are treated like lost packets, which callers already have to cope with.
+class UdpSocket {
+public:
+  // Binds to local_port on all interfaces, or to any free port if it is 0
+  explicit UdpSocket(uint16_t local_port);
+  ~UdpSocket();
+
+  UdpSocket(const UdpSocket&) = delete;
+  UdpSocket& operator=(const UdpSocket&) = delete;
+
+  uint16_t local_port() const;
+
+  // Sets the peer packets are sent to and accepted from. host is an IPv4 address or host name.
+  void connect(const std::string& host, uint16_t port);
+
+  void send(std::span<const uint8_t> data);
+  // Size of the next datagram from the peer copied into buffer, or 0 if none is waiting. Datagrams from anyone
+  // else are discarded.
+  size_t receive(std::span<uint8_t> buffer);
+
+private:
+  void close();
+
+  intptr_t socket_ = -1;
+  uint32_t peer_address_ = 0;  // Network byte order
+  uint16_t peer_port_ = 0;     // Network byte order
+  bool connected_ = false;
+};
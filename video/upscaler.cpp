@@ -0,0 +1,305 @@
+#include "upscaler.h"
+#include <algorithm>
+#include <array>
+#include <cstring>
+#ifdef __SSE2__
+#include <emmintrin.h>
+#endif
+#ifdef __AVX2__
+#include <immintrin.h>
+#endif
+
+namespace {
+// The LCD filter's grid needs room for a lit part in each block, so it only shows from this factor up
+constexpr uint32_t LCD_GRID_MIN_FACTOR = 3;
+constexpr uint32_t OPAQUE = 0xFF000000;
+
+const uint32_t* row(const uint32_t* pixels, size_t pitch, uint32_t y) {
+  return reinterpret_cast<const uint32_t*>(reinterpret_cast<const uint8_t*>(pixels) + y * pitch);
+}
+
+uint32_t* row(uint32_t* pixels, size_t pitch, uint32_t y) {
+  return reinterpret_cast<uint32_t*>(reinterpret_cast<uint8_t*>(pixels) + y * pitch);
+}
+
+// Smoothing splits each pixel into as many cells as divide the factor evenly, 2 at factors that neither does
+uint32_t cells_per_pixel(Upscaler::Filter filter, uint32_t factor) {
+  if (filter != Upscaler::Filter::Smooth || factor == 1) {
+    return 1;
+  }
+  return factor % 3 == 0 ? 3 : 2;
+}
+
+// Each of count pixels repeated factor times
+void replicate(const uint32_t* in, uint32_t count, uint32_t factor, uint32_t* out) {
+  uint32_t i = 0;
+#ifdef __SSE2__
+  // The common factors shuffle four pixels at a time into whole vectors
+  if (factor == 2) {
+    for (; i + 4 <= count; i += 4, out += 8) {
+      const __m128i pixels = _mm_loadu_si128(reinterpret_cast<const __m128i*>(in + i));
+      _mm_storeu_si128(reinterpret_cast<__m128i*>(out), _mm_unpacklo_epi32(pixels, pixels));
+      _mm_storeu_si128(reinterpret_cast<__m128i*>(out + 4), _mm_unpackhi_epi32(pixels, pixels));
+    }
+  } else if (factor == 3) {
+    for (; i + 4 <= count; i += 4, out += 12) {
+      const __m128i pixels = _mm_loadu_si128(reinterpret_cast<const __m128i*>(in + i));
+      _mm_storeu_si128(reinterpret_cast<__m128i*>(out), _mm_shuffle_epi32(pixels, _MM_SHUFFLE(1, 0, 0, 0)));
+      _mm_storeu_si128(reinterpret_cast<__m128i*>(out + 4), _mm_shuffle_epi32(pixels, _MM_SHUFFLE(2, 2, 1, 1)));
+      _mm_storeu_si128(reinterpret_cast<__m128i*>(out + 8), _mm_shuffle_epi32(pixels, _MM_SHUFFLE(3, 3, 3, 2)));
+    }
+  } else if (factor == 4) {
+    for (; i + 4 <= count; i += 4, out += 16) {
+      const __m128i pixels = _mm_loadu_si128(reinterpret_cast<const __m128i*>(in + i));
+      _mm_storeu_si128(reinterpret_cast<__m128i*>(out), _mm_shuffle_epi32(pixels, _MM_SHUFFLE(0, 0, 0, 0)));
+      _mm_storeu_si128(reinterpret_cast<__m128i*>(out + 4), _mm_shuffle_epi32(pixels, _MM_SHUFFLE(1, 1, 1, 1)));
+      _mm_storeu_si128(reinterpret_cast<__m128i*>(out + 8), _mm_shuffle_epi32(pixels, _MM_SHUFFLE(2, 2, 2, 2)));
+      _mm_storeu_si128(reinterpret_cast<__m128i*>(out + 12), _mm_shuffle_epi32(pixels, _MM_SHUFFLE(3, 3, 3, 3)));
+    }
+  }
+#endif
+  // Larger factors store each pixel a vector at a time
+  for (; i < count; i++) {
+    const uint32_t pixel = in[i];
+    uint32_t j = 0;
+#ifdef __AVX2__
+    const __m256i splat8 = _mm256_set1_epi32(static_cast<int>(pixel));
+    for (; j + 8 <= factor; j += 8) {
+      _mm256_storeu_si256(reinterpret_cast<__m256i*>(out + j), splat8);
+    }
+#endif
+#ifdef __SSE2__
+    const __m128i splat4 = _mm_set1_epi32(static_cast<int>(pixel));
+    for (; j + 4 <= factor; j += 4) {
+      _mm_storeu_si128(reinterpret_cast<__m128i*>(out + j), splat4);
+    }
+#endif
+    for (; j < factor; j++) {
+      out[j] = pixel;
+    }
+    out += factor;
+  }
+}
+
+uint32_t darken(uint32_t pixel) {
+  return (((pixel >> 1) & 0x007F7F7F) + ((pixel >> 2) & 0x003F3F3F)) | OPAQUE;
+}
+
+// Three quarters of the brightness of count pixels
+void darken_row(const uint32_t* in, uint32_t count, uint32_t* out) {
+  uint32_t i = 0;
+#ifdef __SSE2__
+  const __m128i half_mask = _mm_set1_epi32(0x007F7F7F);
+  const __m128i quarter_mask = _mm_set1_epi32(0x003F3F3F);
+  const __m128i opaque = _mm_set1_epi32(static_cast<int>(OPAQUE));
+  for (; i + 4 <= count; i += 4) {
+    const __m128i pixels = _mm_loadu_si128(reinterpret_cast<const __m128i*>(in + i));
+    const __m128i half = _mm_and_si128(_mm_srli_epi32(pixels, 1), half_mask);
+    const __m128i quarter = _mm_and_si128(_mm_srli_epi32(pixels, 2), quarter_mask);
+    _mm_storeu_si128(reinterpret_cast<__m128i*>(out + i), _mm_or_si128(_mm_add_epi32(half, quarter), opaque));
+  }
+#endif
+  for (; i < count; i++) {
+    out[i] = darken(in[i]);
+  }
+}
+
+// ghost becomes the average of itself and frame, channel by channel, rounding up
+void blend_row(const uint32_t* frame, uint32_t count, uint32_t* ghost) {
+  uint32_t i = 0;
+#ifdef __SSE2__
+  for (; i + 4 <= count; i += 4) {
+    const __m128i a = _mm_loadu_si128(reinterpret_cast<const __m128i*>(frame + i));
+    const __m128i b = _mm_loadu_si128(reinterpret_cast<const __m128i*>(ghost + i));
+    _mm_storeu_si128(reinterpret_cast<__m128i*>(ghost + i), _mm_avg_epu8(a, b));
+  }
+#endif
+  for (; i < count; i++) {
+    const uint32_t a = frame[i];
+    const uint32_t b = ghost[i];
+    ghost[i] = (a | b) - (((a ^ b) >> 1) & 0x7F7F7F7F);
+  }
+}
+
+// Each pixel of a row as 2x2 cells, into the two rows top and bottom
+void scale2x_row(const uint32_t* above, const uint32_t* pixels, const uint32_t* below, uint32_t width,
+                 uint32_t* top, uint32_t* bottom) {
+  for (uint32_t x = 0; x < width; x++) {
+    const uint32_t b = above[x];
+    const uint32_t d = pixels[x > 0 ? x - 1 : x];
+    const uint32_t e = pixels[x];
+    const uint32_t f = pixels[x + 1 < width ? x + 1 : x];
+    const uint32_t h = below[x];
+    if (b != h && d != f) {
+      top[2 * x] = d == b ? d : e;
+      top[2 * x + 1] = b == f ? f : e;
+      bottom[2 * x] = d == h ? d : e;
+      bottom[2 * x + 1] = h == f ? f : e;
+    } else {
+      top[2 * x] = top[2 * x + 1] = bottom[2 * x] = bottom[2 * x + 1] = e;
+    }
+  }
+}
+
+// Each pixel of a row as 3x3 cells, into the three rows in out
+void scale3x_row(const uint32_t* above, const uint32_t* pixels, const uint32_t* below, uint32_t width,
+                 uint32_t* const* out) {
+  for (uint32_t x = 0; x < width; x++) {
+    const uint32_t left = x > 0 ? x - 1 : x;
+    const uint32_t right = x + 1 < width ? x + 1 : x;
+    const uint32_t a = above[left], b = above[x], c = above[right];
+    const uint32_t d = pixels[left], e = pixels[x], f = pixels[right];
+    const uint32_t g = below[left], h = below[x], i = below[right];
+    uint32_t* top = out[0] + 3 * x;
+    uint32_t* middle = out[1] + 3 * x;
+    uint32_t* bottom = out[2] + 3 * x;
+    if (b != h && d != f) {
+      top[0] = d == b ? d : e;
+      top[1] = (d == b && e != c) || (b == f && e != a) ? b : e;
+      top[2] = b == f ? f : e;
+      middle[0] = (d == b && e != g) || (d == h && e != a) ? d : e;
+      middle[1] = e;
+      middle[2] = (b == f && e != i) || (h == f && e != c) ? f : e;
+      bottom[0] = d == h ? d : e;
+      bottom[1] = (d == h && e != i) || (h == f && e != g) ? h : e;
+      bottom[2] = h == f ? f : e;
+    } else {
+      top[0] = top[1] = top[2] = middle[0] = middle[1] = middle[2] = bottom[0] = bottom[1] = bottom[2] = e;
+    }
+  }
+}
+}  // namespace
+
+Upscaler::Upscaler(uint32_t threads) {
+  if (threads == 0) {
+    threads = std::clamp(std::thread::hardware_concurrency(), 1u, MAX_THREADS);
+  }
+  band_cells_.resize(threads);
+  for (uint32_t band = 1; band < threads; band++) {
+    workers_.emplace_back([this, band]() { work(band); });
+  }
+}
+
+Upscaler::~Upscaler() {
+  stopping_ = true;
+  generation_.fetch_add(1, std::memory_order_release);
+  generation_.notify_all();
+  for (std::thread& worker : workers_) {
+    worker.join();
+  }
+}
+
+void Upscaler::scale(const uint32_t* frame, size_t frame_pitch, uint32_t width, uint32_t height, uint32_t* out,
+                     size_t out_pitch, uint32_t factor, Filter filter) {
+  // The LCD filter starts from the frame itself rather than blending into whatever it last saw
+  if (filter == Filter::LCD && (job_.filter != Filter::LCD || ghost_.size() != width * height)) {
+    ghost_.resize(width * height);
+    for (uint32_t y = 0; y < height; y++) {
+      memcpy(&ghost_[y * width], row(frame, frame_pitch, y), width * sizeof(uint32_t));
+    }
+  }
+  job_ = {frame, frame_pitch, width, height, out, out_pitch, factor, filter, cells_per_pixel(filter, factor)};
+
+  // Cells that don't divide the factor evenly are spread as evenly as whole pixels allow, some a pixel wider
+  if (factor % job_.cells != 0) {
+    cell_map_.resize(width * factor);
+    for (uint32_t x = 0; x < cell_map_.size(); x++) {
+      cell_map_[x] = static_cast<uint16_t>(x * job_.cells / factor);
+    }
+  }
+
+  // Publishing the job through generation_ wakes the workers, then each band counts itself off bands_left_
+  bands_left_.store(threads(), std::memory_order_relaxed);
+  generation_.fetch_add(1, std::memory_order_release);
+  generation_.notify_all();
+  scale_band(0);
+  bands_left_.fetch_sub(1, std::memory_order_acq_rel);
+  for (uint32_t left = bands_left_.load(std::memory_order_acquire); left != 0;
+       left = bands_left_.load(std::memory_order_acquire)) {
+    bands_left_.wait(left, std::memory_order_acquire);
+  }
+}
+
+void Upscaler::work(uint32_t band) {
+  uint32_t seen = 0;
+  while (true) {
+    generation_.wait(seen, std::memory_order_acquire);
+    seen = generation_.load(std::memory_order_acquire);
+    if (stopping_) {
+      return;
+    }
+    scale_band(band);
+    if (bands_left_.fetch_sub(1, std::memory_order_acq_rel) == 1) {
+      bands_left_.notify_one();
+    }
+  }
+}
+
+void Upscaler::scale_band(uint32_t band) {
+  const uint32_t bands = threads();
+  const uint32_t first = job_.height * band / bands;
+  const uint32_t end = job_.height * (band + 1) / bands;
+  for (uint32_t y = first; y < end; y++) {
+    scale_row(y, band_cells_[band]);
+  }
+}
+
+void Upscaler::scale_row(uint32_t y, std::vector<uint32_t>& cells) {
+  const Job& job = job_;
+  const uint32_t cell_width = job.width * job.cells;
+  const uint32_t out_width = job.width * job.factor;
+  const uint32_t* pixels = row(job.frame, job.frame_pitch, y);
+
+  // The frame's row as rows of cells, each becoming about factor / cells rows of output
+  std::array<const uint32_t*, MAX_CELLS> cell_rows = {pixels};
+  if (job.filter == Filter::LCD) {
+    blend_row(pixels, job.width, &ghost_[y * job.width]);
+    cell_rows[0] = &ghost_[y * job.width];
+  } else if (job.cells > 1) {
+    cells.resize(MAX_CELLS * MAX_FACTOR * job.width);
+    const uint32_t* above = row(job.frame, job.frame_pitch, y > 0 ? y - 1 : y);
+    const uint32_t* below = row(job.frame, job.frame_pitch, y + 1 < job.height ? y + 1 : y);
+    std::array<uint32_t*, MAX_CELLS> rows = {&cells[0], &cells[cell_width], &cells[2 * cell_width]};
+    if (job.cells == 2) {
+      scale2x_row(above, pixels, below, job.width, rows[0], rows[1]);
+    } else {
+      scale3x_row(above, pixels, below, job.width, rows.data());
+    }
+    std::copy(rows.begin(), rows.end(), cell_rows.begin());
+  }
+
+  uint32_t* first = row(job.out, job.out_pitch, y * job.factor);
+  if (job.filter == Filter::LCD && job.factor >= LCD_GRID_MIN_FACTOR) {
+    // Every block's last column and last row are the grid between pixels
+    replicate(cell_rows[0], job.width, job.factor, first);
+    for (uint32_t x = job.factor - 1; x < out_width; x += job.factor) {
+      first[x] = darken(first[x]);
+    }
+    for (uint32_t ly = 1; ly + 1 < job.factor; ly++) {
+      memcpy(row(job.out, job.out_pitch, y * job.factor + ly), first, out_width * sizeof(uint32_t));
+    }
+    darken_row(first, out_width, row(job.out, job.out_pitch, y * job.factor + job.factor - 1));
+    return;
+  }
+
+  // Rows showing the same cells are copies of the first of them
+  const uint32_t* last = nullptr;
+  uint32_t last_cell = MAX_CELLS;
+  for (uint32_t ly = 0; ly < job.factor; ly++) {
+    uint32_t* out = row(job.out, job.out_pitch, y * job.factor + ly);
+    const uint32_t cell = ly * job.cells / job.factor;
+    if (cell == last_cell) {
+      memcpy(out, last, out_width * sizeof(uint32_t));
+      continue;
+    }
+    if (job.factor % job.cells == 0) {
+      replicate(cell_rows[cell], cell_width, job.factor / job.cells, out);
+    } else {
+      for (uint32_t x = 0; x < out_width; x++) {
+        out[x] = cell_rows[cell][cell_map_[x]];
+      }
+    }
+    last = out;
+    last_cell = cell;
+  }
+}
@@ -0,0 +1,64 @@
+#pragma once
+
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+#include <thread>
+#include <vector>
+
+// Scales frames up by a whole factor on the CPU, through one of a few filters, into a buffer the size of the
+// window, so the frontend only has to copy it to the screen. The output rows are split into bands, one per thread,
+// with the calling thread taking the first. Only one thread may call scale at a time.
+class Upscaler {
+public:
+  enum class Filter : uint8_t {
+    Nearest,  // Each pixel as a square block
+    Smooth,   // Diagonal edges smoothed by the Scale3x rules at multiples of 3, and the Scale2x rules otherwise
+    LCD,      // Nearest, with dark lines between pixels and each frame blended into the last like a slow LCD
+  };
+  static constexpr uint32_t FILTER_COUNT = 3;
+  static constexpr uint32_t MAX_FACTOR = 20;
+
+  // threads includes the calling thread; 0 picks one per core, up to MAX_THREADS
+  explicit Upscaler(uint32_t threads = 0);
+  ~Upscaler();
+
+  Upscaler(const Upscaler&) = delete;
+  Upscaler& operator=(const Upscaler&) = delete;
+
+  // frame is width x height ARGB pixels, frame_pitch bytes apart row to row. Every pixel of the
+  // width * factor x height * factor output is written, out_pitch bytes apart row to row.
+  void scale(const uint32_t* frame, size_t frame_pitch, uint32_t width, uint32_t height, uint32_t* out,
+             size_t out_pitch, uint32_t factor, Filter filter);
+
+  uint32_t threads() const { return static_cast<uint32_t>(workers_.size()) + 1; }
+
+private:
+  static constexpr uint32_t MAX_THREADS = 4;
+  static constexpr uint32_t MAX_CELLS = 3;  // Sub-pixels each way a filter splits a pixel into, before scaling
+
+  struct Job {
+    const uint32_t* frame;
+    size_t frame_pitch;
+    uint32_t width;
+    uint32_t height;
+    uint32_t* out;
+    size_t out_pitch;
+    uint32_t factor;
+    Filter filter;
+    uint32_t cells;  // Each way, per pixel of the frame
+  };
+
+  void work(uint32_t band);
+  void scale_band(uint32_t band);
+  void scale_row(uint32_t y, std::vector<uint32_t>& cells);
+
+  std::vector<std::thread> workers_;
+  std::vector<std::vector<uint32_t>> band_cells_;  // Each band's sub-pixel rows
+  std::vector<uint32_t> ghost_;                    // The last frame the LCD filter put out, before scaling
+  std::vector<uint16_t> cell_map_;                 // Cell shown at each output column, when cells don't divide factor
+  Job job_ = {};
+  bool stopping_ = false;
+  std::atomic<uint32_t> generation_ = 0;  // Bumped for each job, which wakes the workers
+  std::atomic<uint32_t> bands_left_ = 0;
+};